@@ -0,0 +1,219 @@
+// End-to-end benchmark of FileHash.computeSha256, split into its stages so
+// the overhead around the native hash can be attributed.
+//
+// Build the native library and run headless on Linux:
+//
+//   cmake -S src -B build -DCMAKE_BUILD_TYPE=Release && cmake --build build
+//   LD_LIBRARY_PATH=build dart run benchmark/file_hash_benchmark.dart \
+//       --output benchmark_results.json
+//
+// The native library logs to stdout, so pass --output to keep the JSON report
+// separate. Progress is written to stderr.
+//
+// Options:
+//   --output PATH     Write the JSON report to PATH instead of stdout.
+//   --sizes a,b,...   File sizes in bytes (default 0,1024,65536,1048576,16777216).
+//   --counts a,b,...  Files per batch (default 1,10,100).
+//   --repeats N       Timed repetitions per measurement (default 5).
+
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:isolate';
+
+import 'package:ffi/ffi.dart';
+import 'package:file_hash/file_hash.dart';
+
+/// Mirrors `FileHash._loadLibrary`, which is private to the plugin.
+DynamicLibrary _openLibrary() {
+  if (Platform.isWindows) return DynamicLibrary.open('file_hash.dll');
+  if (Platform.isLinux || Platform.isAndroid) {
+    return DynamicLibrary.open('libfile_hash.so');
+  }
+  return DynamicLibrary.process();
+}
+
+/// Median wall time in microseconds of [repeats] runs of [body], after one
+/// untimed warm-up run.
+Future<double> _medianMicros(int repeats, Future<void> Function() body) async {
+  await body();
+  final samples = <int>[];
+  for (int i = 0; i < repeats; i++) {
+    final stopwatch = Stopwatch()..start();
+    await body();
+    stopwatch.stop();
+    samples.add(stopwatch.elapsedMicroseconds);
+  }
+  samples.sort();
+  return samples[samples.length ~/ 2].toDouble();
+}
+
+/// Times every stage of one `computeSha256` call for each file in [paths].
+/// Returns per-file medians in microseconds.
+Future<Map<String, double>> _measureStages(
+  List<String> paths,
+  int repeats,
+) async {
+  final perFile = paths.length.toDouble();
+  final results = <String, double>{};
+
+  results['isolate_spawn_us'] =
+      await _medianMicros(repeats, () async {
+        for (int i = 0; i < paths.length; i++) {
+          await Isolate.run(() => null);
+        }
+      }) /
+      perFile;
+
+  results['load_library_us'] =
+      await _medianMicros(repeats, () async {
+        for (int i = 0; i < paths.length; i++) {
+          _openLibrary();
+        }
+      }) /
+      perFile;
+
+  final lib = _openLibrary();
+  results['symbol_lookup_us'] =
+      await _medianMicros(repeats, () async {
+        for (int i = 0; i < paths.length; i++) {
+          lib
+              .lookup<NativeFunction<NativeHashFunc>>('sha256_file_native')
+              .asFunction<DartHashFunc>();
+          lib
+              .lookup<NativeFunction<NativeFreeFunc>>('free_sha256_string')
+              .asFunction<DartFreeFunc>();
+        }
+      }) /
+      perFile;
+
+  results['to_native_utf8_us'] =
+      await _medianMicros(repeats, () async {
+        for (final path in paths) {
+          calloc.free(path.toNativeUtf8());
+        }
+      }) /
+      perFile;
+
+  final hashFile = lib
+      .lookup<NativeFunction<NativeHashFunc>>('sha256_file_native')
+      .asFunction<DartHashFunc>();
+  final freeHash = lib
+      .lookup<NativeFunction<NativeFreeFunc>>('free_sha256_string')
+      .asFunction<DartFreeFunc>();
+  final pathPtrs = [for (final path in paths) path.toNativeUtf8()];
+
+  try {
+    // The native call alone; the result strings are kept for the next stage.
+    final resultPtrs = <Pointer<Utf8>>[];
+    results['native_hash_us'] =
+        await _medianMicros(repeats, () async {
+          for (final ptr in resultPtrs) {
+            freeHash(ptr);
+          }
+          resultPtrs.clear();
+          for (final pathPtr in pathPtrs) {
+            resultPtrs.add(hashFile(pathPtr));
+          }
+        }) /
+        perFile;
+
+    results['hex_decode_us'] =
+        await _medianMicros(repeats, () async {
+          for (final ptr in resultPtrs) {
+            ptr.toDartString();
+          }
+        }) /
+        perFile;
+
+    for (final ptr in resultPtrs) {
+      freeHash(ptr);
+    }
+  } finally {
+    for (final pathPtr in pathPtrs) {
+      calloc.free(pathPtr);
+    }
+  }
+
+  results['end_to_end_us'] =
+      await _medianMicros(repeats, () async {
+        await Future.wait(paths.map(FileHash.computeSha256));
+      }) /
+      perFile;
+
+  results['end_to_end_sequential_us'] =
+      await _medianMicros(repeats, () async {
+        for (final path in paths) {
+          await FileHash.computeSha256(path);
+        }
+      }) /
+      perFile;
+
+  return results;
+}
+
+List<int> _parseList(String value) =>
+    value.split(',').map((part) => int.parse(part.trim())).toList();
+
+Future<void> main(List<String> args) async {
+  var sizes = [0, 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024];
+  var counts = [1, 10, 100];
+  var repeats = 5;
+  String? output;
+
+  for (int i = 0; i < args.length; i++) {
+    switch (args[i]) {
+      case '--sizes':
+        sizes = _parseList(args[++i]);
+      case '--counts':
+        counts = _parseList(args[++i]);
+      case '--repeats':
+        repeats = int.parse(args[++i]);
+      case '--output':
+        output = args[++i];
+      default:
+        stderr.writeln('Unknown option ${args[i]}');
+        exit(2);
+    }
+  }
+
+  final tempDir = await Directory.systemTemp.createTemp('file_hash_bench_');
+  final runs = <Map<String, Object>>[];
+
+  try {
+    for (final size in sizes) {
+      final data = List<int>.generate(size, (i) => (i * 31) & 0xff);
+      for (final count in counts) {
+        final paths = <String>[];
+        for (int i = 0; i < count; i++) {
+          final file = File('${tempDir.path}/file_${size}_$i.bin');
+          await file.writeAsBytes(data);
+          paths.add(file.path);
+        }
+
+        final stages = await _measureStages(paths, repeats);
+        runs.add({'file_size': size, 'file_count': count, ...stages});
+        stderr.writeln('size=$size count=$count $stages');
+
+        for (final path in paths) {
+          await File(path).delete();
+        }
+      }
+    }
+  } finally {
+    await tempDir.delete(recursive: true);
+  }
+
+  final report = const JsonEncoder.withIndent('  ').convert({
+    'platform': Platform.operatingSystem,
+    'dart_version': Platform.version,
+    'repeats': repeats,
+    'runs': runs,
+  });
+
+  if (output != null) {
+    await File(output).writeAsString(report);
+  } else {
+    stdout.writeln(report);
+  }
+}
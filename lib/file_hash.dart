@@ -2,6 +2,7 @@ import 'dart:async';
 import 'dart:ffi';
 import 'dart:io';
 import 'dart:isolate';
+import 'dart:typed_data';
 
 import 'package:ffi/ffi.dart';
 
@@ -9,63 +10,1445 @@ import 'package:ffi/ffi.dart';
 typedef NativeHashFunc = Pointer<Utf8> Function(Pointer<Utf8>);
 typedef DartHashFunc = Pointer<Utf8> Function(Pointer<Utf8>);
 
+typedef NativeHashExFunc = Pointer<Utf8> Function(Pointer<Utf8>, Uint32);
+typedef DartHashExFunc = Pointer<Utf8> Function(Pointer<Utf8>, int);
+
+typedef NativeHashFdFunc = Pointer<Utf8> Function(Int32, Uint32);
+typedef DartHashFdFunc = Pointer<Utf8> Function(int, int);
+
+typedef NativeHashHandleFunc = Pointer<Utf8> Function(Pointer<Void>, Uint32);
+typedef DartHashHandleFunc = Pointer<Utf8> Function(Pointer<Void>, int);
+
+typedef NativeHashResultFunc =
+    Int32 Function(Pointer<Utf8>, Uint32, Pointer<NativeHashResult>);
+typedef DartHashResultFunc =
+    int Function(Pointer<Utf8>, int, Pointer<NativeHashResult>);
+
+typedef NativeHashSmallFunc =
+    Int32 Function(Pointer<Utf8>, Uint64, Pointer<NativeHashResult>);
+typedef DartHashSmallFunc =
+    int Function(Pointer<Utf8>, int, Pointer<NativeHashResult>);
+
 typedef NativeFreeFunc = Void Function(Pointer<Utf8>);
 typedef DartFreeFunc = void Function(Pointer<Utf8>);
 
+typedef NativeFingerprintFunc = Pointer<Utf8> Function(Pointer<Utf8>, Int32);
+typedef DartFingerprintFunc = Pointer<Utf8> Function(Pointer<Utf8>, int);
+
+typedef NativeSignatureFunc =
+    Int32 Function(Pointer<Utf8>, Pointer<Utf8>, Uint32);
+typedef DartSignatureFunc = int Function(Pointer<Utf8>, Pointer<Utf8>, int);
+
+/// Shared by `rsync_delta_native` and `rsync_patch_native`.
+typedef NativeThreePathFunc =
+    Int32 Function(Pointer<Utf8>, Pointer<Utf8>, Pointer<Utf8>);
+typedef DartThreePathFunc =
+    int Function(Pointer<Utf8>, Pointer<Utf8>, Pointer<Utf8>);
+
+typedef NativeFindDuplicatesFunc =
+    Int32 Function(Pointer<Pointer<Utf8>>, Int32, Pointer<Int32>);
+typedef DartFindDuplicatesFunc =
+    int Function(Pointer<Pointer<Utf8>>, int, Pointer<Int32>);
+
+typedef NativeChunkFileFunc =
+    Int32 Function(
+      Pointer<Utf8>,
+      Uint32,
+      Uint32,
+      Uint32,
+      Pointer<Pointer<NativeFileChunk>>,
+      Pointer<Uint8>,
+    );
+typedef DartChunkFileFunc =
+    int Function(
+      Pointer<Utf8>,
+      int,
+      int,
+      int,
+      Pointer<Pointer<NativeFileChunk>>,
+      Pointer<Uint8>,
+    );
+
+typedef NativeFreeChunksFunc = Void Function(Pointer<NativeFileChunk>);
+typedef DartFreeChunksFunc = void Function(Pointer<NativeFileChunk>);
+
+typedef NativeVerifyFileFunc = Int32 Function(Pointer<Utf8>, Pointer<Uint8>);
+typedef DartVerifyFileFunc = int Function(Pointer<Utf8>, Pointer<Uint8>);
+
+typedef NativeHashFilesFunc =
+    Int32 Function(
+      Pointer<Pointer<Utf8>>,
+      Int32,
+      Int32,
+      Pointer<NativeHashResult>,
+      Pointer<Int32>,
+    );
+typedef DartHashFilesFunc =
+    int Function(
+      Pointer<Pointer<Utf8>>,
+      int,
+      int,
+      Pointer<NativeHashResult>,
+      Pointer<Int32>,
+    );
+
+typedef NativeVerifyCallback = Void Function(Int32, Int32);
+typedef NativeVerifyManifestFunc =
+    Int32 Function(
+      Pointer<Pointer<Utf8>>,
+      Pointer<Uint8>,
+      Int32,
+      Int32,
+      Int32,
+      Pointer<Int32>,
+      Pointer<NativeFunction<NativeVerifyCallback>>,
+    );
+typedef DartVerifyManifestFunc =
+    int Function(
+      Pointer<Pointer<Utf8>>,
+      Pointer<Uint8>,
+      int,
+      int,
+      int,
+      Pointer<Int32>,
+      Pointer<NativeFunction<NativeVerifyCallback>>,
+    );
+
+typedef NativeGetStatsFunc = Void Function(Pointer<NativeFileHashStats>);
+typedef DartGetStatsFunc = void Function(Pointer<NativeFileHashStats>);
+
+typedef NativeResetStatsFunc = Void Function();
+typedef DartResetStatsFunc = void Function();
+
+typedef NativeEngineNameFunc = Pointer<Utf8> Function();
+typedef DartEngineNameFunc = Pointer<Utf8> Function();
+
+typedef NativeTraceStartFunc = Int32 Function(Uint32);
+typedef DartTraceStartFunc = int Function(int);
+
+typedef NativeTraceStopFunc = Void Function();
+typedef DartTraceStopFunc = void Function();
+
+typedef NativeTraceDumpFunc = Pointer<Utf8> Function();
+typedef DartTraceDumpFunc = Pointer<Utf8> Function();
+
+/// Mirrors `fh_stats` in `src/file_hash.h`.
+final class NativeFileHashStats extends Struct {
+  @Uint64()
+  external int files;
+
+  @Uint64()
+  external int failures;
+
+  @Uint64()
+  external int bytes;
+
+  @Uint64()
+  external int readCalls;
+
+  @Uint64()
+  external int readNs;
+
+  @Uint64()
+  external int hashNs;
+}
+
+/// Process-wide counters of the native streaming hash path.
+///
+/// Comparing [readTime] with [hashTime] shows whether hashing is limited by
+/// storage or by the digest computation.
+class FileHashStats {
+  const FileHashStats({
+    required this.engine,
+    required this.files,
+    required this.failures,
+    required this.bytes,
+    required this.readCalls,
+    required this.readTime,
+    required this.hashTime,
+  });
+
+  /// The native SHA-256 engine, e.g. `OpenSSL EVP (Hardware Accelerated)`.
+  final String engine;
+
+  /// Files hashed successfully.
+  final int files;
+
+  /// Files that failed to open, read or hash.
+  final int failures;
+
+  /// Bytes read and hashed.
+  final int bytes;
+
+  /// Read calls issued, including the final one that hits end of file.
+  final int readCalls;
+
+  /// Time spent waiting for reads.
+  final Duration readTime;
+
+  /// Time spent in the digest update.
+  final Duration hashTime;
+
+  @override
+  String toString() =>
+      'FileHashStats(engine: $engine, files: $files, failures: $failures, '
+      'bytes: $bytes, readCalls: $readCalls, readTime: $readTime, '
+      'hashTime: $hashTime)';
+}
+
+/// How [FileHash.computeSha256] reads through the OS page cache.
+enum CacheMode {
+  /// Ordinary cached reads. Best when the file is read again soon.
+  normal,
+
+  /// Drops each range from the page cache once it has been hashed, so a
+  /// one-shot pass over cold data does not evict everything else. Same as
+  /// [direct] on Windows, which has no drop-behind.
+  dropBehind,
+
+  /// Reads around the page cache (`O_DIRECT` on Linux and Android,
+  /// `F_NOCACHE` on Apple platforms, `FILE_FLAG_NO_BUFFERING` on Windows),
+  /// falling back to [dropBehind] on filesystems that do not support it.
+  direct,
+}
+
+/// Outcome of checking a file against an expected digest.
+enum VerifyStatus {
+  /// The file's SHA-256 equals the expected digest.
+  match,
+
+  /// The file was read but its SHA-256 differs.
+  mismatch,
+
+  /// The file could not be opened or read.
+  unreadable,
+
+  /// The file was not checked because an earlier failure stopped the run.
+  skipped,
+}
+
+/// Mirrors `fh_chunk` in `src/file_hash.h`.
+final class NativeFileChunk extends Struct {
+  @Array(32)
+  external Array<Uint8> digest;
+
+  @Uint64()
+  external int offset;
+
+  @Uint64()
+  external int length;
+}
+
+/// Mirrors the `FH_STATUS_*` codes in `src/file_hash.h`.
+abstract final class _HashStatus {
+  static const int ok = 0;
+  static const int notFound = 1;
+  static const int permissionDenied = 2;
+  static const int ioError = 3;
+  static const int engineFailure = 4;
+  static const int cancelled = 5;
+  static const int outOfMemory = 6;
+  static const int notAFile = 7;
+  static const int modified = 8;
+  static const int tooLarge = 9;
+}
+
+/// Mirrors `fh_hash_result` in `src/file_hash.h`.
+final class NativeHashResult extends Struct {
+  @Array(32)
+  external Array<Uint8> digest;
+
+  @Int32()
+  external int status;
+
+  @Int32()
+  external int osError;
+
+  @Uint64()
+  external int offset;
+
+  @Uint64()
+  external int size;
+
+  @Int64()
+  external int mtimeNs;
+
+  @Uint64()
+  external int inode;
+
+  @Uint64()
+  external int device;
+}
+
+/// A content-defined chunk of a file.
+class FileChunk {
+  const FileChunk(this.offset, this.length, this.sha256);
+
+  /// Byte offset of the chunk within the file.
+  final int offset;
+
+  /// Length of the chunk in bytes.
+  final int length;
+
+  /// SHA-256 of the chunk contents as 64 lowercase hex characters.
+  final String sha256;
+}
+
+/// The result of [FileHash.computeChunks].
+class ChunkedFile {
+  const ChunkedFile(this.sha256, this.chunks);
+
+  /// SHA-256 of the whole file as 64 lowercase hex characters.
+  final String sha256;
+
+  /// The chunks in file order. Empty for an empty file.
+  final List<FileChunk> chunks;
+}
+
+/// Why a file could not be hashed.
+///
+/// [isTransient] separates failures worth retrying (I/O errors, running out
+/// of memory, cancellation, a concurrent write) from permanent ones.
+sealed class FileHashException implements IOException {
+  const FileHashException(this.path, this.osError);
+
+  /// The file that failed.
+  final String path;
+
+  /// The `errno` (`GetLastError()` on Windows) behind the failure, or 0.
+  final int osError;
+
+  /// Whether hashing the file again may succeed.
+  bool get isTransient => false;
+
+  String get _reason;
+
+  @override
+  String toString() {
+    final os = osError != 0 ? ' (OS error $osError)' : '';
+    return 'FileHashException: $_reason: $path$os';
+  }
+}
+
+/// The file or a directory on its path does not exist.
+final class FileHashNotFoundException extends FileHashException {
+  const FileHashNotFoundException(super.path, super.osError);
+
+  @override
+  String get _reason => 'not found';
+}
+
+/// The file may not be opened for reading.
+final class FileHashPermissionException extends FileHashException {
+  const FileHashPermissionException(super.path, super.osError);
+
+  @override
+  String get _reason => 'permission denied';
+}
+
+/// Opening or reading the file failed.
+final class FileHashIOException extends FileHashException {
+  const FileHashIOException(super.path, super.osError, this.offset);
+
+  /// Bytes read before the failure.
+  final int offset;
+
+  @override
+  bool get isTransient => true;
+
+  @override
+  String get _reason => 'I/O error at offset $offset';
+}
+
+/// The native SHA-256 engine reported an error.
+final class FileHashEngineException extends FileHashException {
+  const FileHashEngineException(super.path, super.osError);
+
+  @override
+  String get _reason => 'hash engine failure';
+}
+
+/// The file was not hashed because its batch was cancelled.
+final class FileHashCancelledException extends FileHashException {
+  const FileHashCancelledException(super.path, super.osError);
+
+  @override
+  bool get isTransient => true;
+
+  @override
+  String get _reason => 'cancelled';
+}
+
+/// The path names a directory, device or pipe rather than a regular file.
+final class FileHashNotAFileException extends FileHashException {
+  const FileHashNotAFileException(super.path, super.osError);
+
+  @override
+  String get _reason => 'not a regular file';
+}
+
+/// No read buffer could be allocated.
+final class FileHashOutOfMemoryException extends FileHashException {
+  const FileHashOutOfMemoryException(super.path, super.osError);
+
+  @override
+  bool get isTransient => true;
+
+  @override
+  String get _reason => 'out of memory';
+}
+
+/// The file was written to while it was read, so the digest would not match
+/// any one version of it: its size, modification time or change time moved
+/// between opening it and reading its last block.
+final class FileHashModifiedException extends FileHashException {
+  const FileHashModifiedException(super.path, super.osError);
+
+  @override
+  bool get isTransient => true;
+
+  @override
+  String get _reason => 'modified while hashing';
+}
+
+/// The file is larger than [FileHash.computeSha256Sync] was allowed to
+/// block for. It was not read.
+final class FileHashTooLargeException extends FileHashException {
+  const FileHashTooLargeException(super.path, super.osError);
+
+  @override
+  String get _reason => 'too large to hash synchronously';
+}
+
+/// The digest of a file, or why it could not be computed.
+///
+/// Results of [FileHash.computeSha256WithMetadata] also carry the file's
+/// metadata, read from the descriptor that was hashed, so it describes the
+/// same file as the digest. It is null in batch results.
+class FileHashResult {
+  const FileHashResult(
+    this.path,
+    this.sha256,
+    this.error, {
+    this.size,
+    this.mtimeNs,
+    this.inode,
+    this.device,
+  });
+
+  /// The file hashed.
+  final String path;
+
+  /// SHA-256 as 64 lowercase hex characters, or null if [error] is set.
+  final String? sha256;
+
+  /// Why the file could not be hashed, or null on success.
+  final FileHashException? error;
+
+  /// Size in bytes when the file was opened.
+  final int? size;
+
+  /// Last modification time in nanoseconds since the Unix epoch.
+  final int? mtimeNs;
+
+  /// Inode number (file ID on Windows).
+  final int? inode;
+
+  /// Device number (volume serial number on Windows).
+  final int? device;
+
+  /// [mtimeNs] as a [DateTime], truncated to microseconds.
+  DateTime? get modified {
+    final ns = mtimeNs;
+    if (ns == null) return null;
+    return DateTime.fromMicrosecondsSinceEpoch(ns ~/ 1000);
+  }
+}
+
+/// Cancels a running [FileHash.computeSha256Batch] or
+/// [FileHash.computeSha256BatchResults] from the calling isolate.
+///
+/// The flag lives in native memory, where the batch's worker threads poll it
+/// between reads. Files not finished by then fail with
+/// [FileHashCancelledException].
+class HashCancellation implements Finalizable {
+  HashCancellation() : _flag = calloc<Int32>() {
+    _finalizer.attach(this, _flag.cast());
+  }
+
+  static final _finalizer = NativeFinalizer(calloc.nativeFree);
+
+  final Pointer<Int32> _flag;
+
+  /// Whether [cancel] has been called.
+  bool get isCancelled => _flag.value != 0;
+
+  /// Stops the batches using this token.
+  void cancel() {
+    _flag.value = 1;
+  }
+}
+
+/// The addresses of the native functions, resolved once per process.
+///
+/// The background isolates behind [FileHash]'s asynchronous methods are
+/// spawned per call, so anything they looked up themselves would be opened
+/// and resolved again on every call. Pointers and functions cannot be sent
+/// to another isolate, but plain addresses can: they are resolved here, in
+/// the calling isolate, and captured by each [Isolate.run] closure, which
+/// rebuilds the functions it calls with [_Native].
+final class _Symbols {
+  _Symbols._(DynamicLibrary library)
+    : hashFile = _address(library, 'sha256_file_native'),
+      hashFileEx = _address(library, 'sha256_file_ex_native'),
+      hashFileResult = _address(library, 'sha256_file_result_native'),
+      hashSmallFile = _address(library, 'sha256_file_small_native'),
+      hashFd = _address(library, 'sha256_fd_native'),
+      hashHandle = Platform.isWindows
+          ? _address(library, 'sha256_handle_native')
+          : 0,
+      freeString = _address(library, 'free_sha256_string'),
+      quickFingerprint = _address(library, 'sha256_quick_fingerprint_native'),
+      chunkFile = _address(library, 'chunk_file_native'),
+      freeChunks = _address(library, 'free_chunk_list'),
+      rsyncSignature = _address(library, 'rsync_signature_native'),
+      rsyncDelta = _address(library, 'rsync_delta_native'),
+      rsyncPatch = _address(library, 'rsync_patch_native'),
+      hashFiles = _address(library, 'sha256_files_native'),
+      verifyFile = _address(library, 'sha256_verify_file_native'),
+      verifyManifest = _address(library, 'sha256_verify_manifest_native'),
+      findDuplicates = _address(library, 'find_duplicates_native'),
+      getStats = _address(library, 'fh_get_stats'),
+      resetStats = _address(library, 'fh_reset_stats'),
+      engineName = _address(library, 'fh_engine_name'),
+      traceStart = _address(library, 'fh_trace_start'),
+      traceStop = _address(library, 'fh_trace_stop'),
+      traceDump = _address(library, 'fh_trace_dump_json');
+
+  /// Resolved on first use in this isolate. The library stays loaded for the
+  /// life of the process, so the addresses stay valid in every isolate.
+  static final _Symbols resolved = _Symbols._(FileHash._loadLibrary());
+
+  static int _address(DynamicLibrary library, String symbol) =>
+      library.lookup<Void>(symbol).address;
+
+  final int hashFile;
+  final int hashFileEx;
+  final int hashFileResult;
+  final int hashSmallFile;
+  final int hashFd;
+  /// 0 except on Windows, the only platform that exports the function.
+  final int hashHandle;
+  final int freeString;
+  final int quickFingerprint;
+  final int chunkFile;
+  final int freeChunks;
+  final int rsyncSignature;
+  final int rsyncDelta;
+  final int rsyncPatch;
+  final int hashFiles;
+  final int verifyFile;
+  final int verifyManifest;
+  final int findDuplicates;
+  final int getStats;
+  final int resetStats;
+  final int engineName;
+  final int traceStart;
+  final int traceStop;
+  final int traceDump;
+}
+
+/// The native functions at the addresses in a [_Symbols], each built on
+/// first use. Building one from an address involves no `dlopen` or `dlsym`.
+final class _Native {
+  _Native(this._symbols);
+
+  /// For the methods that call the library from the calling isolate.
+  static final _Native local = _Native(_Symbols.resolved);
+
+  final _Symbols _symbols;
+
+  late final DartHashFunc hashFile =
+      Pointer<NativeFunction<NativeHashFunc>>.fromAddress(
+        _symbols.hashFile,
+      ).asFunction();
+
+  late final DartHashExFunc hashFileEx =
+      Pointer<NativeFunction<NativeHashExFunc>>.fromAddress(
+        _symbols.hashFileEx,
+      ).asFunction();
+
+  late final DartHashResultFunc hashFileResult =
+      Pointer<NativeFunction<NativeHashResultFunc>>.fromAddress(
+        _symbols.hashFileResult,
+      ).asFunction();
+
+  /// Never calls back into Dart, so it is bound as a leaf call and skips the
+  /// VM's safepoint transition.
+  late final DartHashSmallFunc hashSmallFile =
+      Pointer<NativeFunction<NativeHashSmallFunc>>.fromAddress(
+        _symbols.hashSmallFile,
+      ).asFunction(isLeaf: true);
+
+  late final DartHashFdFunc hashFd =
+      Pointer<NativeFunction<NativeHashFdFunc>>.fromAddress(
+        _symbols.hashFd,
+      ).asFunction();
+
+  late final DartHashHandleFunc hashHandle =
+      Pointer<NativeFunction<NativeHashHandleFunc>>.fromAddress(
+        _symbols.hashHandle,
+      ).asFunction();
+
+  late final DartFreeFunc freeString =
+      Pointer<NativeFunction<NativeFreeFunc>>.fromAddress(
+        _symbols.freeString,
+      ).asFunction();
+
+  late final DartFingerprintFunc quickFingerprint =
+      Pointer<NativeFunction<NativeFingerprintFunc>>.fromAddress(
+        _symbols.quickFingerprint,
+      ).asFunction();
+
+  late final DartChunkFileFunc chunkFile =
+      Pointer<NativeFunction<NativeChunkFileFunc>>.fromAddress(
+        _symbols.chunkFile,
+      ).asFunction();
+
+  late final DartFreeChunksFunc freeChunks =
+      Pointer<NativeFunction<NativeFreeChunksFunc>>.fromAddress(
+        _symbols.freeChunks,
+      ).asFunction();
+
+  late final DartSignatureFunc rsyncSignature =
+      Pointer<NativeFunction<NativeSignatureFunc>>.fromAddress(
+        _symbols.rsyncSignature,
+      ).asFunction();
+
+  late final DartThreePathFunc rsyncDelta =
+      Pointer<NativeFunction<NativeThreePathFunc>>.fromAddress(
+        _symbols.rsyncDelta,
+      ).asFunction();
+
+  late final DartThreePathFunc rsyncPatch =
+      Pointer<NativeFunction<NativeThreePathFunc>>.fromAddress(
+        _symbols.rsyncPatch,
+      ).asFunction();
+
+  late final DartHashFilesFunc hashFiles =
+      Pointer<NativeFunction<NativeHashFilesFunc>>.fromAddress(
+        _symbols.hashFiles,
+      ).asFunction();
+
+  late final DartVerifyFileFunc verifyFile =
+      Pointer<NativeFunction<NativeVerifyFileFunc>>.fromAddress(
+        _symbols.verifyFile,
+      ).asFunction();
+
+  late final DartVerifyManifestFunc verifyManifest =
+      Pointer<NativeFunction<NativeVerifyManifestFunc>>.fromAddress(
+        _symbols.verifyManifest,
+      ).asFunction();
+
+  late final DartFindDuplicatesFunc findDuplicates =
+      Pointer<NativeFunction<NativeFindDuplicatesFunc>>.fromAddress(
+        _symbols.findDuplicates,
+      ).asFunction();
+
+  late final DartGetStatsFunc getStats =
+      Pointer<NativeFunction<NativeGetStatsFunc>>.fromAddress(
+        _symbols.getStats,
+      ).asFunction();
+
+  late final DartResetStatsFunc resetStats =
+      Pointer<NativeFunction<NativeResetStatsFunc>>.fromAddress(
+        _symbols.resetStats,
+      ).asFunction();
+
+  late final DartEngineNameFunc engineName =
+      Pointer<NativeFunction<NativeEngineNameFunc>>.fromAddress(
+        _symbols.engineName,
+      ).asFunction();
+
+  late final DartTraceStartFunc traceStart =
+      Pointer<NativeFunction<NativeTraceStartFunc>>.fromAddress(
+        _symbols.traceStart,
+      ).asFunction();
+
+  late final DartTraceStopFunc traceStop =
+      Pointer<NativeFunction<NativeTraceStopFunc>>.fromAddress(
+        _symbols.traceStop,
+      ).asFunction();
+
+  late final DartTraceDumpFunc traceDump =
+      Pointer<NativeFunction<NativeTraceDumpFunc>>.fromAddress(
+        _symbols.traceDump,
+      ).asFunction();
+}
+
 class FileHash {
   /// Hashes a file in a separate background thread (Isolate).
   /// This prevents the UI from freezing.
-  static Future<String?> computeSha256(String filePath) async {
+  ///
+  /// Use [CacheMode.dropBehind] or [CacheMode.direct] for one-shot passes
+  /// over large cold files.
+  static Future<String?> computeSha256(
+    String filePath, {
+    CacheMode cacheMode = CacheMode.normal,
+  }) async {
+    final symbols = _Symbols.resolved;
     // Isolate.run automatically spawns a thread, runs the code,
     // returns the result, and closes the thread.
     return await Isolate.run(() {
-      return _hashFileSynchronous(filePath);
+      return _hashFileSynchronous(_Native(symbols), filePath, cacheMode);
     });
   }
 
   /// This private function runs inside the Background Isolate.
-  static String? _hashFileSynchronous(String filePath) {
-    // Note: We check file existence here in the isolate to avoid race conditions
-    // but you can also do it in the main thread if you prefer.
-    final file = File(filePath);
-    if (!file.existsSync()) return null;
-
-    // 1. Re-open the library inside the Isolate
-    // (DynamicLibraries cannot be passed between Isolates, so we load it here)
-    final DynamicLibrary lib = _loadLibrary();
-
-    // 2. Lookup functions
-    final DartHashFunc nativeHashFile = lib
-        .lookup<NativeFunction<NativeHashFunc>>('sha256_file_native')
-        .asFunction();
-
-    final DartFreeFunc nativeFreeHash = lib
-        .lookup<NativeFunction<NativeFreeFunc>>('free_sha256_string')
-        .asFunction();
-
-    // 3. Prepare Memory
+  static String? _hashFileSynchronous(
+    _Native native,
+    String filePath,
+    CacheMode cacheMode,
+  ) {
+    // Missing files and directories are rejected natively, from the same
+    // open as the read, so there is no separate stat here.
+
+    // 1. Prepare Memory
     final pathPtr = filePath.toNativeUtf8();
 
     try {
-      // 4. BLOCKING CALL (This is fine now, because we are in an Isolate)
-      final resultPtr = nativeHashFile(pathPtr);
+      // 2. BLOCKING CALL (This is fine now, because we are in an Isolate).
+      // The function comes from an address resolved by the calling isolate.
+      final resultPtr = cacheMode == CacheMode.normal
+          ? native.hashFile(pathPtr)
+          : native.hashFileEx(pathPtr, _readFlags(cacheMode));
 
       if (resultPtr == nullptr) return null;
 
       final hash = resultPtr.toDartString();
 
-      // 5. Free the C string memory
-      nativeFreeHash(resultPtr);
+      // 3. Free the C string memory
+      native.freeString(resultPtr);
 
       return hash;
     } finally {
-      // 6. Free the path string memory
+      // 4. Free the path string memory
+      calloc.free(pathPtr);
+    }
+  }
+
+  /// As [computeSha256], but throws a [FileHashException] saying why the
+  /// file could not be hashed instead of returning null.
+  static Future<String> computeSha256OrThrow(
+    String filePath, {
+    CacheMode cacheMode = CacheMode.normal,
+  }) async {
+    final result = await computeSha256WithMetadata(
+      filePath,
+      cacheMode: cacheMode,
+    );
+    final error = result.error;
+    if (error != null) throw error;
+    return result.sha256!;
+  }
+
+  /// Hashes a file and returns its digest together with its size,
+  /// modification time, inode and device, all from the one open of the
+  /// file. Use these to validate a cached digest instead of a separate
+  /// [File.stat], which could see a different version of the file.
+  ///
+  /// Failures are returned in [FileHashResult.error] rather than thrown.
+  static Future<FileHashResult> computeSha256WithMetadata(
+    String filePath, {
+    CacheMode cacheMode = CacheMode.normal,
+  }) async {
+    final symbols = _Symbols.resolved;
+    return await Isolate.run(() {
+      final pathPtr = filePath.toNativeUtf8();
+      final resultPtr = calloc<NativeHashResult>();
+      try {
+        final hashFileResult = _Native(symbols).hashFileResult;
+        hashFileResult(pathPtr, _readFlags(cacheMode), resultPtr);
+        return _toHashResult(filePath, resultPtr.ref);
+      } finally {
+        calloc.free(pathPtr);
+        calloc.free(resultPtr);
+      }
+    });
+  }
+
+  /// The default `maxSize` of [computeSha256Sync].
+  static const int syncSizeLimit = 64 * 1024;
+
+  /// Hashes a small file on the calling isolate, blocking it until the
+  /// digest is ready.
+  ///
+  /// Spawning the isolate behind [computeSha256] costs far more than hashing
+  /// a file of a few kilobytes, so checking many small files (configuration,
+  /// startup integrity checks) is much faster this way. So that the caller is
+  /// never stalled by a large file, files over [maxSize] bytes are not read
+  /// and fail with [FileHashTooLargeException]; hash those with
+  /// [computeSha256WithMetadata] instead.
+  ///
+  /// Failures are returned in [FileHashResult.error] rather than thrown.
+  static FileHashResult computeSha256Sync(
+    String filePath, {
+    int maxSize = syncSizeLimit,
+  }) {
+    final pathPtr = filePath.toNativeUtf8();
+    final resultPtr = calloc<NativeHashResult>();
+    try {
+      _Native.local.hashSmallFile(pathPtr, maxSize, resultPtr);
+      return _toHashResult(filePath, resultPtr.ref);
+    } finally {
+      calloc.free(pathPtr);
+      calloc.free(resultPtr);
+    }
+  }
+
+  /// Converts a native result for [filePath].
+  static FileHashResult _toHashResult(
+    String filePath,
+    NativeHashResult result,
+  ) {
+    if (result.status == _HashStatus.ok) {
+      final digest = Uint8List(32);
+      for (int i = 0; i < 32; i++) {
+        digest[i] = result.digest[i];
+      }
+      return FileHashResult(
+        filePath,
+        _toHex(digest),
+        null,
+        size: result.size,
+        mtimeNs: result.mtimeNs,
+        inode: result.inode,
+        device: result.device,
+      );
+    }
+    return FileHashResult(
+      filePath,
+      null,
+      _hashException(filePath, result.status, result.osError, result.offset),
+    );
+  }
+
+  /// The exception for an `FH_STATUS_*` code other than `FH_STATUS_OK`.
+  static FileHashException _hashException(
+    String filePath,
+    int status,
+    int osError,
+    int offset,
+  ) {
+    switch (status) {
+      case _HashStatus.notFound:
+        return FileHashNotFoundException(filePath, osError);
+      case _HashStatus.permissionDenied:
+        return FileHashPermissionException(filePath, osError);
+      case _HashStatus.engineFailure:
+        return FileHashEngineException(filePath, osError);
+      case _HashStatus.cancelled:
+        return FileHashCancelledException(filePath, osError);
+      case _HashStatus.outOfMemory:
+        return FileHashOutOfMemoryException(filePath, osError);
+      case _HashStatus.notAFile:
+        return FileHashNotAFileException(filePath, osError);
+      case _HashStatus.modified:
+        return FileHashModifiedException(filePath, osError);
+      case _HashStatus.tooLarge:
+        return FileHashTooLargeException(filePath, osError);
+      case _HashStatus.ioError:
+      default:
+        return FileHashIOException(filePath, osError, offset);
+    }
+  }
+
+  /// Hashes an already open file descriptor from its current position to the
+  /// end, without closing it. Works for pipes and sockets too, and for the
+  /// descriptor of an Android content URI (`ParcelFileDescriptor.detachFd`),
+  /// which then does not have to be copied to a cache file first.
+  ///
+  /// On Windows [fd] is a C runtime descriptor; see [computeSha256FromHandle]
+  /// for Win32 handles. [CacheMode.direct] acts as [CacheMode.dropBehind],
+  /// since the descriptor's open mode belongs to the caller. Returns null if
+  /// the descriptor cannot be read.
+  static Future<String?> computeSha256FromDescriptor(
+    int fd, {
+    CacheMode cacheMode = CacheMode.normal,
+  }) async {
+    final symbols = _Symbols.resolved;
+    return await Isolate.run(() {
+      final native = _Native(symbols);
+      return _takeHexResult(native, native.hashFd(fd, _readFlags(cacheMode)));
+    });
+  }
+
+  /// As [computeSha256FromDescriptor], for a Win32 file or pipe `HANDLE`
+  /// opened without `FILE_FLAG_OVERLAPPED`. Windows only.
+  static Future<String?> computeSha256FromHandle(
+    int handle, {
+    CacheMode cacheMode = CacheMode.normal,
+  }) async {
+    if (!Platform.isWindows) {
+      throw UnsupportedError('Win32 handles exist only on Windows');
+    }
+    final symbols = _Symbols.resolved;
+    return await Isolate.run(() {
+      final native = _Native(symbols);
+      return _takeHexResult(
+        native,
+        native.hashHandle(Pointer.fromAddress(handle), _readFlags(cacheMode)),
+      );
+    });
+  }
+
+  /// The `flags` argument of the native read functions for [cacheMode].
+  static int _readFlags(CacheMode cacheMode) {
+    switch (cacheMode) {
+      case CacheMode.normal:
+        return 0;
+      case CacheMode.dropBehind:
+        return 1;
+      case CacheMode.direct:
+        return 2;
+    }
+  }
+
+  /// Converts and frees a hex string returned by the native library.
+  static String? _takeHexResult(_Native native, Pointer<Utf8> resultPtr) {
+    if (resultPtr == nullptr) return null;
+    try {
+      return resultPtr.toDartString();
+    } finally {
+      native.freeString(resultPtr);
+    }
+  }
+
+  /// Computes a quick fingerprint of a file from its size and a fixed set of
+  /// sampled 16 KB blocks: the head, the tail and [stripes] evenly spaced
+  /// blocks in between.
+  ///
+  /// This returns in milliseconds even for multi-GB files, which makes it
+  /// suitable as a change/identity signal in list views. It is not a content
+  /// hash: edits that fall between the sampled blocks go unnoticed, so use
+  /// [computeSha256] when integrity matters. Returns null if the file cannot
+  /// be read.
+  static Future<String?> computeQuickFingerprint(
+    String filePath, {
+    int stripes = 8,
+  }) async {
+    final symbols = _Symbols.resolved;
+    return await Isolate.run(() {
+      return _fingerprintFileSynchronous(_Native(symbols), filePath, stripes);
+    });
+  }
+
+  /// Runs inside the Background Isolate, like [_hashFileSynchronous].
+  static String? _fingerprintFileSynchronous(
+    _Native native,
+    String filePath,
+    int stripes,
+  ) {
+    final pathPtr = filePath.toNativeUtf8();
+
+    try {
+      final resultPtr = native.quickFingerprint(pathPtr, stripes);
+
+      if (resultPtr == nullptr) return null;
+
+      final fingerprint = resultPtr.toDartString();
+      native.freeString(resultPtr);
+
+      return fingerprint;
+    } finally {
       calloc.free(pathPtr);
     }
   }
 
+  /// Splits a file into content-defined chunks and hashes every chunk and the
+  /// whole file in a single native read pass.
+  ///
+  /// Boundaries come from a FastCDC rolling hash over the content, so an
+  /// insertion or deletion only changes the chunks around the edit, which is
+  /// what makes deduplicated upload and delta sync work. Chunks are between
+  /// [minSize] and [maxSize] bytes and average about [avgSize]. Returns null if
+  /// the file cannot be read or the sizes are invalid.
+  static Future<ChunkedFile?> computeChunks(
+    String filePath, {
+    int minSize = 16 * 1024,
+    int avgSize = 64 * 1024,
+    int maxSize = 256 * 1024,
+  }) async {
+    final symbols = _Symbols.resolved;
+    return await Isolate.run(() {
+      return _chunkFileSynchronous(
+        _Native(symbols),
+        filePath,
+        minSize,
+        avgSize,
+        maxSize,
+      );
+    });
+  }
+
+  /// Runs inside the Background Isolate, like [_hashFileSynchronous].
+  static ChunkedFile? _chunkFileSynchronous(
+    _Native native,
+    String filePath,
+    int minSize,
+    int avgSize,
+    int maxSize,
+  ) {
+    final pathPtr = filePath.toNativeUtf8();
+    final chunksPtr = calloc<Pointer<NativeFileChunk>>();
+    final digestPtr = calloc<Uint8>(32);
+
+    try {
+      final count = native.chunkFile(
+        pathPtr,
+        minSize,
+        avgSize,
+        maxSize,
+        chunksPtr,
+        digestPtr,
+      );
+      if (count < 0) return null;
+
+      final chunks = <FileChunk>[];
+      for (int i = 0; i < count; i++) {
+        final chunk = chunksPtr.value[i];
+        final digest = List<int>.generate(32, (j) => chunk.digest[j]);
+        chunks.add(FileChunk(chunk.offset, chunk.length, _toHex(digest)));
+      }
+
+      return ChunkedFile(_toHex(digestPtr.asTypedList(32)), chunks);
+    } finally {
+      if (chunksPtr.value != nullptr) native.freeChunks(chunksPtr.value);
+      calloc.free(pathPtr);
+      calloc.free(chunksPtr);
+      calloc.free(digestPtr);
+    }
+  }
+
+  /// Writes an rsync-style block signature of [filePath] to [signaturePath].
+  ///
+  /// The signature holds a rolling checksum and a SHA-256 for every block of
+  /// [blockSize] bytes (0 picks a size from the file length). Send it to the
+  /// side that has the new version of the file and pass it to [createDelta].
+  /// Returns false on failure.
+  static Future<bool> createSignature(
+    String filePath,
+    String signaturePath, {
+    int blockSize = 0,
+  }) async {
+    final symbols = _Symbols.resolved;
+    return await Isolate.run(() {
+      final pathPtr = filePath.toNativeUtf8();
+      final signaturePtr = signaturePath.toNativeUtf8();
+      try {
+        final signature = _Native(symbols).rsyncSignature;
+        return signature(pathPtr, signaturePtr, blockSize) == 0;
+      } finally {
+        calloc.free(pathPtr);
+        calloc.free(signaturePtr);
+      }
+    });
+  }
+
+  /// Writes a delta to [deltaPath] that describes [newFilePath] as blocks of
+  /// the old file (identified by [signaturePath]) plus literal bytes.
+  ///
+  /// Only changed regions end up as literals, so the delta of a lightly edited
+  /// large file is a small fraction of its size. Returns false on failure.
+  static Future<bool> createDelta(
+    String signaturePath,
+    String newFilePath,
+    String deltaPath,
+  ) async {
+    final symbols = _Symbols.resolved;
+    return await Isolate.run(() {
+      return _callThreePathFunction(
+        _Native(symbols).rsyncDelta,
+        signaturePath,
+        newFilePath,
+        deltaPath,
+      );
+    });
+  }
+
+  /// Rebuilds the new file at [outputPath] from the old file at [basisPath]
+  /// and a delta from [createDelta].
+  ///
+  /// The result is checked against the SHA-256 of the new file stored in the
+  /// delta; on mismatch nothing is left at [outputPath] and false is returned.
+  static Future<bool> applyDelta(
+    String basisPath,
+    String deltaPath,
+    String outputPath,
+  ) async {
+    final symbols = _Symbols.resolved;
+    return await Isolate.run(() {
+      return _callThreePathFunction(
+        _Native(symbols).rsyncPatch,
+        basisPath,
+        deltaPath,
+        outputPath,
+      );
+    });
+  }
+
+  /// Runs inside the Background Isolate, like [_hashFileSynchronous].
+  static bool _callThreePathFunction(
+    DartThreePathFunc function,
+    String first,
+    String second,
+    String third,
+  ) {
+    final firstPtr = first.toNativeUtf8();
+    final secondPtr = second.toNativeUtf8();
+    final thirdPtr = third.toNativeUtf8();
+    try {
+      return function(firstPtr, secondPtr, thirdPtr) == 0;
+    } finally {
+      calloc.free(firstPtr);
+      calloc.free(secondPtr);
+      calloc.free(thirdPtr);
+    }
+  }
+
+  /// Computes the SHA-256 of every file in [paths] on [threads] native
+  /// worker threads (0 picks a default) in one isolate hop.
+  ///
+  /// Returns the hex digests in the order of [paths], with `null` for files
+  /// that could not be read. On ARM64 each worker hashes two files at a time
+  /// through an interleaved kernel, which raises per-core throughput.
+  /// See [computeSha256BatchResults] for why files failed.
+  static Future<List<String?>> computeSha256Batch(
+    List<String> paths, {
+    int threads = 0,
+    HashCancellation? cancellation,
+  }) async {
+    final results = await computeSha256BatchResults(
+      paths,
+      threads: threads,
+      cancellation: cancellation,
+    );
+    return [for (final result in results) result.sha256];
+  }
+
+  /// As [computeSha256Batch], with the reason each failed file could not be
+  /// hashed (including its OS error and the offset a read failed at), so
+  /// that only transient failures need to be retried, and each file's
+  /// metadata as [computeSha256WithMetadata] returns it.
+  ///
+  /// [cancellation] stops the batch early; files not finished by then fail
+  /// with [FileHashCancelledException].
+  static Future<List<FileHashResult>> computeSha256BatchResults(
+    List<String> paths, {
+    int threads = 0,
+    HashCancellation? cancellation,
+  }) async {
+    if (paths.isEmpty) return [];
+
+    final cancelAddress = cancellation?._flag.address ?? 0;
+    final symbols = _Symbols.resolved;
+    return await Isolate.run(() {
+      final pathPtrs = calloc<Pointer<Utf8>>(paths.length);
+      final resultsPtr = calloc<NativeHashResult>(paths.length);
+      try {
+        for (int i = 0; i < paths.length; i++) {
+          pathPtrs[i] = paths[i].toNativeUtf8();
+        }
+
+        _Native(symbols).hashFiles(
+          pathPtrs,
+          paths.length,
+          threads,
+          resultsPtr,
+          Pointer.fromAddress(cancelAddress),
+        );
+
+        return [
+          for (int i = 0; i < paths.length; i++)
+            _toHashResult(paths[i], resultsPtr[i]),
+        ];
+      } finally {
+        for (int i = 0; i < paths.length; i++) {
+          if (pathPtrs[i] != nullptr) calloc.free(pathPtrs[i]);
+        }
+        calloc.free(pathPtrs);
+        calloc.free(resultsPtr);
+      }
+    });
+  }
+
+  /// Hashes a file and compares the result with [expectedSha256] (64 hex
+  /// characters) natively, without building a hex string for the result.
+  static Future<VerifyStatus> verifySha256(
+    String filePath,
+    String expectedSha256,
+  ) async {
+    final expected = _fromHex(expectedSha256);
+    final symbols = _Symbols.resolved;
+    return await Isolate.run(() {
+      final pathPtr = filePath.toNativeUtf8();
+      final expectedPtr = calloc<Uint8>(32);
+      try {
+        expectedPtr.asTypedList(32).setAll(0, expected);
+        final verify = _Native(symbols).verifyFile;
+        return _verifyStatus(verify(pathPtr, expectedPtr));
+      } finally {
+        calloc.free(pathPtr);
+        calloc.free(expectedPtr);
+      }
+    });
+  }
+
+  /// Verifies every file in [manifest] (path to expected SHA-256 hex) on
+  /// [threads] native worker threads (0 picks a default) in one isolate hop.
+  ///
+  /// [onFailure] is called as soon as each mismatching or unreadable file is
+  /// found, before the whole manifest has been checked. With
+  /// [stopOnFirstFailure] the workers stop at the first failure and the files
+  /// they did not reach are reported as [VerifyStatus.skipped].
+  static Future<Map<String, VerifyStatus>> verifyManifest(
+    Map<String, String> manifest, {
+    int threads = 0,
+    bool stopOnFirstFailure = false,
+    void Function(String path, VerifyStatus status)? onFailure,
+  }) async {
+    final paths = manifest.keys.toList();
+    final digests = Uint8List(paths.length * 32);
+    for (int i = 0; i < paths.length; i++) {
+      digests.setAll(i * 32, _fromHex(manifest[paths[i]]!));
+    }
+
+    // Failures are delivered from the worker threads through a listener that
+    // posts back to this isolate. Wait until all of them have arrived before
+    // closing it, since they race with the result of the isolate.
+    NativeCallable<NativeVerifyCallback>? listener;
+    var reported = 0;
+    var expectedReports = -1;
+    final allReported = Completer<void>();
+    if (onFailure != null) {
+      listener = NativeCallable<NativeVerifyCallback>.listener((
+        int index,
+        int result,
+      ) {
+        onFailure(paths[index], _verifyStatus(result));
+        reported++;
+        if (reported == expectedReports) allReported.complete();
+      });
+    }
+
+    try {
+      final results = await _runVerifyManifest(
+        paths,
+        digests,
+        threads,
+        stopOnFirstFailure,
+        listener?.nativeFunction.address ?? 0,
+      );
+
+      if (listener != null) {
+        expectedReports = results.where((r) => r != 1 && r != -2).length;
+        if (reported < expectedReports) await allReported.future;
+      }
+
+      return {
+        for (int i = 0; i < paths.length; i++)
+          paths[i]: _verifyStatus(results[i]),
+      };
+    } finally {
+      listener?.close();
+    }
+  }
+
+  /// Kept separate from [verifyManifest] so the isolate closure only
+  /// captures sendable values.
+  static Future<List<int>> _runVerifyManifest(
+    List<String> paths,
+    Uint8List digests,
+    int threads,
+    bool stopOnFirstFailure,
+    int callbackAddress,
+  ) {
+    final symbols = _Symbols.resolved;
+    return Isolate.run(() {
+      final pathPtrs = calloc<Pointer<Utf8>>(paths.length);
+      final digestsPtr = calloc<Uint8>(digests.length);
+      final resultsPtr = calloc<Int32>(paths.length);
+      try {
+        for (int i = 0; i < paths.length; i++) {
+          pathPtrs[i] = paths[i].toNativeUtf8();
+        }
+        digestsPtr.asTypedList(digests.length).setAll(0, digests);
+
+        _Native(symbols).verifyManifest(
+          pathPtrs,
+          digestsPtr,
+          paths.length,
+          threads,
+          stopOnFirstFailure ? 1 : 0,
+          resultsPtr,
+          Pointer.fromAddress(callbackAddress),
+        );
+        return List<int>.of(resultsPtr.asTypedList(paths.length));
+      } finally {
+        for (int i = 0; i < paths.length; i++) {
+          if (pathPtrs[i] != nullptr) calloc.free(pathPtrs[i]);
+        }
+        calloc.free(pathPtrs);
+        calloc.free(digestsPtr);
+        calloc.free(resultsPtr);
+      }
+    });
+  }
+
+  static VerifyStatus _verifyStatus(int result) {
+    switch (result) {
+      case 1:
+        return VerifyStatus.match;
+      case 0:
+        return VerifyStatus.mismatch;
+      case -2:
+        return VerifyStatus.skipped;
+      default:
+        return VerifyStatus.unreadable;
+    }
+  }
+
+  /// Parses a 64-character hex SHA-256 digest.
+  static Uint8List _fromHex(String hex) {
+    if (hex.length != 64) {
+      throw ArgumentError.value(hex, 'hex', 'Expected 64 hex characters');
+    }
+    final bytes = Uint8List(32);
+    for (int i = 0; i < 32; i++) {
+      final byte = int.tryParse(hex.substring(i * 2, i * 2 + 2), radix: 16);
+      if (byte == null) {
+        throw ArgumentError.value(hex, 'hex', 'Invalid hex digit');
+      }
+      bytes[i] = byte;
+    }
+    return bytes;
+  }
+
+  /// Formats a digest as lowercase hex, matching the native hex strings.
+  static String _toHex(List<int> bytes) {
+    final buffer = StringBuffer();
+    for (final byte in bytes) {
+      buffer.write(byte.toRadixString(16).padLeft(2, '0'));
+    }
+    return buffer.toString();
+  }
+
+  /// Groups the files in [paths] whose contents are byte-identical.
+  ///
+  /// Files are compared by size first, then by a hash of their first and last
+  /// 4 KB, and only files that still collide are hashed in full, so most files
+  /// are never read completely. Every returned group holds at least two paths,
+  /// in input order. Missing or unreadable files are left out.
+  static Future<List<List<String>>> findDuplicates(List<String> paths) async {
+    if (paths.length < 2) return [];
+    final symbols = _Symbols.resolved;
+    return await Isolate.run(() {
+      return _findDuplicatesSynchronous(_Native(symbols), paths);
+    });
+  }
+
+  /// Runs inside the Background Isolate, like [_hashFileSynchronous].
+  static List<List<String>> _findDuplicatesSynchronous(
+    _Native native,
+    List<String> paths,
+  ) {
+    final pathPtrs = calloc<Pointer<Utf8>>(paths.length);
+    final groupIds = calloc<Int32>(paths.length);
+
+    try {
+      for (int i = 0; i < paths.length; i++) {
+        pathPtrs[i] = paths[i].toNativeUtf8();
+      }
+
+      final groupCount = native.findDuplicates(
+        pathPtrs,
+        paths.length,
+        groupIds,
+      );
+      if (groupCount < 0) {
+        throw StateError('Native duplicate detection ran out of memory');
+      }
+
+      final groups = List.generate(groupCount, (_) => <String>[]);
+      for (int i = 0; i < paths.length; i++) {
+        final id = groupIds[i];
+        if (id >= 0) groups[id].add(paths[i]);
+      }
+      return groups;
+    } finally {
+      for (int i = 0; i < paths.length; i++) {
+        if (pathPtrs[i] != nullptr) calloc.free(pathPtrs[i]);
+      }
+      calloc.free(pathPtrs);
+      calloc.free(groupIds);
+    }
+  }
+
+  /// Native counters accumulated since the library was loaded or
+  /// [resetStats] was last called, across all isolates and threads.
+  static FileHashStats get stats {
+    final statsPtr = calloc<NativeFileHashStats>();
+    try {
+      _Native.local.getStats(statsPtr);
+      final native = statsPtr.ref;
+      return FileHashStats(
+        engine: _Native.local.engineName().toDartString(),
+        files: native.files,
+        failures: native.failures,
+        bytes: native.bytes,
+        readCalls: native.readCalls,
+        readTime: Duration(microseconds: native.readNs ~/ 1000),
+        hashTime: Duration(microseconds: native.hashNs ~/ 1000),
+      );
+    } finally {
+      calloc.free(statsPtr);
+    }
+  }
+
+  /// Resets the counters reported by [stats].
+  static void resetStats() {
+    _Native.local.resetStats();
+  }
+
+  /// Starts recording native trace events (open, each read block, digest
+  /// update, finalize and result marshalling) for every hash, in any isolate,
+  /// into a ring buffer that keeps the last [capacity] events.
+  static void startTracing({int capacity = 65536}) {
+    if (_Native.local.traceStart(capacity) != 0) {
+      throw StateError('Could not allocate a trace buffer of $capacity events');
+    }
+  }
+
+  /// Stops tracing and returns the recorded events as a Chrome trace event
+  /// JSON document, which Perfetto and `chrome://tracing` can open.
+  ///
+  /// Timestamps are in microseconds on the monotonic clock that the Flutter
+  /// timeline also uses on Linux and Android.
+  static String stopTracing() {
+    _Native.local.traceStop();
+    final jsonPtr = _Native.local.traceDump();
+    if (jsonPtr == nullptr) {
+      throw StateError('Could not allocate the trace dump');
+    }
+    try {
+      return jsonPtr.toDartString();
+    } finally {
+      _Native.local.freeString(jsonPtr);
+    }
+  }
+
   /// Helper to load the library based on the platform.
-  /// This is called inside the Isolate.
+  /// Called once per calling isolate, by [_Symbols].
   static DynamicLibrary _loadLibrary() {
     if (Platform.isWindows) {
       return DynamicLibrary.open('file_hash.dll');
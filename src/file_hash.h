@@ -18,8 +18,154 @@
 extern "C" {
 #endif
 
+    // One content-defined chunk of a file.
+    typedef struct {
+        uint8_t digest[32];
+        uint64_t offset;
+        uint64_t length;
+    } fh_chunk;
+
+    // Process-wide counters for the streaming hash path (sha256_file_native,
+    // the full-hash stage of find_duplicates_native, verification and small
+    // files in sha256_quick_fingerprint_native).
+    typedef struct {
+        uint64_t files;       // Files hashed successfully
+        uint64_t failures;    // Files that failed to open, read or hash
+        uint64_t bytes;       // Bytes read and hashed
+        uint64_t read_calls;  // Read calls, including the final one at EOF
+        uint64_t read_ns;     // Time spent waiting for reads
+        uint64_t hash_ns;     // Time spent in the digest update
+    } fh_stats;
+
+    // Why hashing a file failed.
+    enum {
+        FH_STATUS_OK = 0,
+        FH_STATUS_NOT_FOUND = 1,          // No such file or directory
+        FH_STATUS_PERMISSION_DENIED = 2,  // Not allowed to open the file
+        FH_STATUS_IO_ERROR = 3,           // Open or read failed; may be transient
+        FH_STATUS_ENGINE_FAILURE = 4,     // The SHA-256 engine reported an error
+        FH_STATUS_CANCELLED = 5,          // Cancelled before it finished
+        FH_STATUS_OUT_OF_MEMORY = 6,      // No buffer could be allocated
+        FH_STATUS_NOT_A_FILE = 7,         // A directory, device or pipe
+        FH_STATUS_MODIFIED = 8,           // Written to while it was hashed
+        FH_STATUS_TOO_LARGE = 9,          // Over the caller's size limit
+    };
+
+    // The digest of a file, or why it could not be computed. Path hashing
+    // also fills in the file's metadata from the descriptor it read, so it
+    // describes the same file as the digest and no separate stat is needed.
+    typedef struct {
+        uint8_t digest[32];
+        int32_t status;    // FH_STATUS_*
+        int32_t os_error;  // errno, or GetLastError() on Windows; 0 if none
+        uint64_t offset;   // Bytes read, up to the failure if any
+        uint64_t size;     // File size when it was opened
+        int64_t mtime_ns;  // Last modification, in ns since the Unix epoch
+        uint64_t inode;    // File ID on Windows
+        uint64_t device;   // Volume serial number on Windows
+    } fh_hash_result;
+
+    // Receives the index and result of each manifest entry that failed.
+    // Called from worker threads as failures are found.
+    typedef void (*fh_verify_callback)(int32_t index, int32_t result);
+
     FFI_PLUGIN_EXPORT char* sha256_file_native(char* filepath);
     FFI_PLUGIN_EXPORT void free_sha256_string(char* ptr);
+    // sha256_file_native without logging, with read `flags`: 1 drops each
+    // range from the page cache once hashed, 2 reads with O_DIRECT (falling
+    // back to 1 where the filesystem refuses it). Windows reads with
+    // FILE_FLAG_NO_BUFFERING for either flag.
+    FFI_PLUGIN_EXPORT char* sha256_file_ex_native(char* filepath, uint32_t flags);
+    // sha256_file_ex_native with the raw digest, the file's metadata and
+    // the reason for a failure written to `result`. Returns result->status.
+    FFI_PLUGIN_EXPORT int32_t sha256_file_result_native(char* filepath, uint32_t flags, fh_hash_result* result);
+    // sha256_file_result_native for callers that block on it, such as a UI
+    // thread checking small files: fails with FH_STATUS_TOO_LARGE, without
+    // reading, if the file holds more than `max_size` bytes. Never calls
+    // back into the caller, so it may be bound as an FFI leaf call.
+    FFI_PLUGIN_EXPORT int32_t sha256_file_small_native(char* filepath, uint64_t max_size, fh_hash_result* result);
+    // Hashes an already open file, pipe or socket from its current position
+    // to the end, without closing it. Flag 1 is honored; 2 acts as 1 since
+    // the descriptor's open mode belongs to the caller. On Windows `fd` is a
+    // C runtime descriptor. Free the result with free_sha256_string.
+    FFI_PLUGIN_EXPORT char* sha256_fd_native(int32_t fd, uint32_t flags);
+#ifdef _WIN32
+    // As sha256_fd_native, for a Win32 file or pipe HANDLE.
+    FFI_PLUGIN_EXPORT char* sha256_handle_native(void* handle, uint32_t flags);
+#endif
+
+    // Statistics since load or the last reset. fh_get_stats is cheap enough
+    // to poll; counters are published when each file finishes.
+    FFI_PLUGIN_EXPORT void fh_get_stats(fh_stats* out);
+    FFI_PLUGIN_EXPORT void fh_reset_stats(void);
+    // Name of the SHA-256 engine this build uses. Owned by the library.
+    FFI_PLUGIN_EXPORT const char* fh_engine_name(void);
+
+    // Tracing of the open, read, digest update, finalize and marshalling
+    // phases into a ring buffer of the last `capacity` events. Returns 0 on
+    // success. Costs one branch per trace point while stopped.
+    FFI_PLUGIN_EXPORT int32_t fh_trace_start(uint32_t capacity);
+    FFI_PLUGIN_EXPORT void fh_trace_stop(void);
+    // The recorded events as Chrome trace JSON (microsecond timestamps on
+    // the monotonic clock). Free the result with free_sha256_string.
+    FFI_PLUGIN_EXPORT char* fh_trace_dump_json(void);
+
+    // Groups byte-identical files. Writes a group id (0..n-1) for every path
+    // that has at least one duplicate, or -1 otherwise, into `group_ids`.
+    // Returns the number of groups, or -1 if memory could not be allocated.
+    FFI_PLUGIN_EXPORT int32_t find_duplicates_native(char** paths, int32_t count, int32_t* group_ids);
+
+    // Hashes the file size plus `stripes + 2` evenly spaced 16 KB blocks
+    // (head and tail included) into a hex fingerprint. Much cheaper than a full
+    // hash for large files, but only an identity hint: edits between the
+    // sampled blocks are not detected. Free the result with free_sha256_string.
+    FFI_PLUGIN_EXPORT char* sha256_quick_fingerprint_native(char* filepath, int32_t stripes);
+
+    // Splits a file into content-defined chunks (FastCDC) of `min_size` to
+    // `max_size` bytes, averaging about `avg_size`, and SHA-256 hashes every
+    // chunk and the whole file (into `file_digest`) in a single read pass.
+    // Stores the chunk array in `*chunks` and returns its length, or -1 on
+    // failure. Free the array with free_chunk_list.
+    FFI_PLUGIN_EXPORT int32_t chunk_file_native(char* filepath, uint32_t min_size, uint32_t avg_size,
+                                                uint32_t max_size, fh_chunk** chunks, uint8_t* file_digest);
+    FFI_PLUGIN_EXPORT void free_chunk_list(fh_chunk* chunks);
+
+    // rsync-style block signatures and deltas. Each returns 0 on success and
+    // -1 on failure, in which case no partial output file is left behind.
+    //
+    // Writes the signature of `filepath` (weak rolling checksum and SHA-256
+    // per block) to `signature_path`. A `block_len` of 0 picks one from the
+    // file size.
+    FFI_PLUGIN_EXPORT int32_t rsync_signature_native(char* filepath, char* signature_path, uint32_t block_len);
+    // Writes a delta that rebuilds `filepath` from the file the signature
+    // was made of.
+    FFI_PLUGIN_EXPORT int32_t rsync_delta_native(char* signature_path, char* filepath, char* delta_path);
+    // Rebuilds the new file from `basis_path` and a delta, verifying the
+    // result against the SHA-256 recorded in the delta.
+    FFI_PLUGIN_EXPORT int32_t rsync_patch_native(char* basis_path, char* delta_path, char* output_path);
+
+    // Hashes a file and compares it with the 32-byte `expected` digest.
+    // Returns 1 on match, 0 on mismatch and -1 if the file cannot be read.
+    FFI_PLUGIN_EXPORT int32_t sha256_verify_file_native(char* filepath, const uint8_t* expected);
+    // Verifies `count` files against consecutive 32-byte digests in
+    // `expected` on `threads` workers (0 picks a default). Writes a result per
+    // file as above, or -2 for files skipped after `stop_on_failure` stopped
+    // the run, and reports failures through the optional `on_failure`.
+    // Files that could not be checked for lack of memory count as -1.
+    // Returns the number of failed files.
+    FFI_PLUGIN_EXPORT int32_t sha256_verify_manifest_native(char** paths, const uint8_t* expected, int32_t count,
+                                                            int32_t threads, int32_t stop_on_failure,
+                                                            int32_t* results, fh_verify_callback on_failure);
+
+    // Hashes `count` files on `threads` workers (0 picks a default). Where
+    // the engine has an interleaved kernel (ARMv8 crypto), each worker
+    // hashes two files at once. Fills one result per file as
+    // sha256_file_result_native does and returns the number of failed files.
+    // Setting `*cancel` (optional) to nonzero from another thread stops the
+    // batch; the files not finished by then get FH_STATUS_CANCELLED. Files
+    // no worker could take on for lack of memory get FH_STATUS_OUT_OF_MEMORY.
+    FFI_PLUGIN_EXPORT int32_t sha256_files_native(char** paths, int32_t count, int32_t threads,
+                                                  fh_hash_result* results, const volatile int32_t* cancel);
 
 #ifdef __cplusplus
 }
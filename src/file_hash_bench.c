@@ -0,0 +1,502 @@
+// Native benchmark harness for the SHA-256 kernels and the file read path.
+//
+// Built as the `file_hash_bench` target of src/CMakeLists.txt. The library
+// source is compiled into this executable (like the iOS/macOS forwarders do)
+// with FILE_HASH_BENCH defined, which also builds every portable kernel the
+// target supports next to the platform engine.
+//
+// Usage:
+//   file_hash_bench [--verify] [--memory] [--files] [--max-size SIZE]
+//                   [--ghz GHZ] [--dir DIR]
+//
+//   --verify     Check every engine against known answers and each other.
+//   --memory     In-memory throughput and latency per engine (default).
+//   --files      End-to-end file hashing, warm and cold page cache.
+//   --max-size   Largest input, e.g. 256M or 4G (default 256M).
+//   --ghz        Core clock used to report cycles/byte where no cycle
+//                counter is available.
+//   --dir        Directory for temporary files (default: current directory).
+
+#define FILE_HASH_BENCH 1
+#include "file_hash.c"
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+    #include <fcntl.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define FH_BENCH_HAVE_TSC 1
+#endif
+
+// --- ENGINES ---
+
+typedef struct {
+    const char *name;
+    // Hashes `total` bytes made of `data` (`len` bytes) over and over, so
+    // large inputs need no buffer of their own. `len` is a multiple of 64
+    // whenever it is shorter than `total`.
+    void (*digest)(const uint8_t *data, size_t len, uint64_t total, uint8_t hash[32]);
+    // Independent streams hashed per call; throughput counts all of them.
+    int streams;
+} bench_engine;
+
+// The length of the next piece of a `total`-byte input of which `done`
+// bytes have been hashed.
+static size_t bench_piece(size_t len, uint64_t total, uint64_t done) {
+    return total - done < len ? (size_t)(total - done) : len;
+}
+
+static void bench_platform(const uint8_t *data, size_t len, uint64_t total, uint8_t hash[32]) {
+    fh_sha256_ctx ctx;
+    memset(hash, 0, 32);
+    if (!fh_sha256_init(&ctx)) return;
+    for (uint64_t done = 0; done < total; done += len) {
+        if (!fh_sha256_update(&ctx, data, bench_piece(len, total, done))) {
+            fh_sha256_abort(&ctx);
+            return;
+        }
+    }
+    if (!fh_sha256_final(&ctx, hash)) memset(hash, 0, 32);
+}
+
+static void bench_bundled_with(void (*transform)(SHA256_CTX_BUNDLED *ctx, const uint8_t data[64]),
+                               const uint8_t *data, size_t len, uint64_t total, uint8_t hash[32]) {
+    SHA256_CTX_BUNDLED ctx;
+    sha256_init_bundled(&ctx);
+    ctx.transform = transform;
+    for (uint64_t done = 0; done < total; done += len) {
+        sha256_update_bundled(&ctx, data, bench_piece(len, total, done));
+    }
+    sha256_final_bundled(&ctx, hash);
+}
+
+static void bench_bundled(const uint8_t *data, size_t len, uint64_t total, uint8_t hash[32]) {
+    bench_bundled_with(sha256_transform_bundled, data, len, total, hash);
+}
+
+#ifdef FH_BUILD_BMI2
+static void bench_bmi2(const uint8_t *data, size_t len, uint64_t total, uint8_t hash[32]) {
+    bench_bundled_with(__builtin_cpu_supports("bmi2") ? sha256_transform_bmi2 : sha256_transform_bundled, data,
+                       len, total, hash);
+}
+#endif
+
+#ifdef FH_BUILD_NEON_SCHEDULE
+static void bench_neon_schedule(const uint8_t *data, size_t len, uint64_t total, uint8_t hash[32]) {
+    bench_bundled_with(sha256_transform_neon, data, len, total, hash);
+}
+#endif
+
+#ifdef FH_BUILD_ARM_CRYPTO
+static void bench_arm_crypto(const uint8_t *data, size_t len, uint64_t total, uint8_t hash[32]) {
+    SHA256_ARM_CTX ctx;
+    sha256_arm_init(&ctx);
+    for (uint64_t done = 0; done < total; done += len) {
+        sha256_arm_update(&ctx, data, bench_piece(len, total, done));
+    }
+    sha256_arm_final(&ctx, hash);
+}
+
+// Hashes `data` as two streams through the interleaved kernel.
+static void bench_arm_crypto_x2(const uint8_t *data, size_t len, uint64_t total, uint8_t hash[32]) {
+    SHA256_ARM_CTX a, b;
+    uint8_t other[32];
+    sha256_arm_init(&a);
+    sha256_arm_init(&b);
+    for (uint64_t done = 0; done < total; done += len) {
+        size_t piece = bench_piece(len, total, done);
+        size_t aligned = piece & ~(size_t)63;
+        sha256_arm_update_x2(&a, data, &b, data, aligned);
+        sha256_arm_update(&a, data + aligned, piece - aligned);
+        sha256_arm_update(&b, data + aligned, piece - aligned);
+    }
+    sha256_arm_final(&a, hash);
+    sha256_arm_final(&b, other);
+    if (memcmp(hash, other, 32) != 0) memset(hash, 0, 32);
+}
+#endif
+
+static const bench_engine ENGINES[] = {
+    { "platform (" FH_ENGINE_NAME ")", bench_platform, 1 },
+    { "bundled C", bench_bundled, 1 },
+#ifdef FH_BUILD_BMI2
+    { "bundled C, BMI2", bench_bmi2, 1 },
+#endif
+#ifdef FH_BUILD_NEON_SCHEDULE
+    { "bundled C + NEON schedule", bench_neon_schedule, 1 },
+#endif
+#ifdef FH_BUILD_ARM_CRYPTO
+    { "ARM crypto", bench_arm_crypto, 1 },
+    { "ARM crypto, 2 streams", bench_arm_crypto_x2, 2 },
+#endif
+};
+
+#define ENGINE_COUNT (sizeof(ENGINES) / sizeof(ENGINES[0]))
+
+// --- TIMING ---
+
+static uint64_t bench_cycles(void) {
+#ifdef FH_BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static int bench_compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+typedef struct {
+    double gbps;
+    double cycles_per_byte;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+} bench_stats;
+
+// Runs `iterations` samples and summarises them. `run` returns the number of
+// bytes it processed.
+static bench_stats bench_measure(int iterations, double ghz, uint64_t (*run)(void *ctx), void *ctx) {
+    uint64_t *samples = (uint64_t *)malloc(sizeof(uint64_t) * (size_t)iterations);
+    uint64_t total_ns = 0, total_bytes = 0, total_cycles = 0;
+    bench_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (!samples) return stats;
+
+    for (int i = 0; i < iterations; i++) {
+        uint64_t c0 = bench_cycles();
+        uint64_t t0 = fh_now_ns();
+        total_bytes += run(ctx);
+        uint64_t t1 = fh_now_ns();
+        total_cycles += bench_cycles() - c0;
+        samples[i] = t1 - t0;
+        total_ns += samples[i];
+    }
+    qsort(samples, (size_t)iterations, sizeof(uint64_t), bench_compare_u64);
+
+    if (total_ns > 0) stats.gbps = (double)total_bytes / (double)total_ns;
+    if (total_bytes > 0) {
+#ifdef FH_BENCH_HAVE_TSC
+        (void)ghz;
+        stats.cycles_per_byte = (double)total_cycles / (double)total_bytes;
+#else
+        stats.cycles_per_byte = ghz > 0 ? (double)total_ns * ghz / (double)total_bytes : 0;
+#endif
+    }
+    stats.p50_ns = samples[(size_t)iterations * 50 / 100];
+    stats.p90_ns = samples[(size_t)iterations * 90 / 100];
+    stats.p99_ns = samples[(size_t)iterations * 99 / 100];
+    free(samples);
+    return stats;
+}
+
+// Enough iterations for ~256 MiB of work per point, within [5, 10000].
+static int bench_iterations(uint64_t size) {
+    uint64_t n = size ? (256ull << 20) / size : 10000;
+    if (n < 5) n = 5;
+    if (n > 10000) n = 10000;
+    return (int)n;
+}
+
+static void bench_print_header(const char *first) {
+    printf("%-44s %12s %9s %9s %12s %12s %12s\n", first, "size", "GB/s", "cyc/B", "p50", "p90", "p99");
+}
+
+static void bench_format_size(uint64_t size, char *out, size_t len) {
+    if (size >= (1ull << 30) && size % (1ull << 30) == 0) snprintf(out, len, "%lluG", (unsigned long long)(size >> 30));
+    else if (size >= (1ull << 20) && size % (1ull << 20) == 0) snprintf(out, len, "%lluM", (unsigned long long)(size >> 20));
+    else if (size >= 1024 && size % 1024 == 0) snprintf(out, len, "%lluK", (unsigned long long)(size >> 10));
+    else snprintf(out, len, "%llu", (unsigned long long)size);
+}
+
+static void bench_format_ns(uint64_t ns, char *out, size_t len) {
+    if (ns >= 1000000000ull) snprintf(out, len, "%.2fs", ns / 1e9);
+    else if (ns >= 1000000ull) snprintf(out, len, "%.2fms", ns / 1e6);
+    else if (ns >= 1000ull) snprintf(out, len, "%.2fus", ns / 1e3);
+    else snprintf(out, len, "%lluns", (unsigned long long)ns);
+}
+
+static void bench_print_row(const char *name, uint64_t size, const bench_stats *s) {
+    char sz[32], p50[32], p90[32], p99[32], cpb[32];
+    bench_format_size(size, sz, sizeof(sz));
+    bench_format_ns(s->p50_ns, p50, sizeof(p50));
+    bench_format_ns(s->p90_ns, p90, sizeof(p90));
+    bench_format_ns(s->p99_ns, p99, sizeof(p99));
+    if (s->cycles_per_byte > 0) snprintf(cpb, sizeof(cpb), "%.2f", s->cycles_per_byte);
+    else snprintf(cpb, sizeof(cpb), "-");
+    printf("%-44s %12s %9.3f %9s %12s %12s %12s\n", name, sz, s->gbps, cpb, p50, p90, p99);
+}
+
+static void bench_fill(uint8_t *data, size_t len) {
+    uint64_t x = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        data[i] = (uint8_t)x;
+    }
+}
+
+// --- VERIFY ---
+
+static int bench_verify(void) {
+    static const struct {
+        const char *input;
+        size_t repeat;
+        const char *hex;
+    } vectors[] = {
+        { "", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+        { "abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+        { "a", 1000000, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+    };
+    int failures = 0;
+
+    for (size_t v = 0; v < sizeof(vectors) / sizeof(vectors[0]); v++) {
+        size_t unit = strlen(vectors[v].input);
+        size_t len = unit * vectors[v].repeat;
+        uint8_t *data = (uint8_t *)malloc(len + 1);
+        if (!data) return 1;
+        for (size_t r = 0; r < vectors[v].repeat; r++) memcpy(data + r * unit, vectors[v].input, unit);
+
+        for (size_t e = 0; e < ENGINE_COUNT; e++) {
+            uint8_t hash[32];
+            char hex[65];
+            ENGINES[e].digest(data, len, len, hash);
+            fh_to_hex(hash, hex);
+            if (strcmp(hex, vectors[v].hex) != 0) {
+                printf("FAIL %s: vector %zu got %s\n", ENGINES[e].name, v, hex);
+                failures++;
+            }
+        }
+        free(data);
+    }
+
+    // Every length around the block and padding boundaries, against the
+    // platform engine.
+    uint8_t data[1024];
+    bench_fill(data, sizeof(data));
+    for (size_t len = 0; len <= sizeof(data); len++) {
+        uint8_t expected[32];
+        ENGINES[0].digest(data, len, len, expected);
+        for (size_t e = 1; e < ENGINE_COUNT; e++) {
+            uint8_t hash[32];
+            ENGINES[e].digest(data, len, len, hash);
+            if (memcmp(hash, expected, 32) != 0) {
+                printf("FAIL %s: length %zu differs from platform engine\n", ENGINES[e].name, len);
+                failures++;
+            }
+        }
+    }
+
+    // Hashing a repeated piece, as the memory benchmark does for large
+    // sizes, must match hashing the whole input at once.
+    uint8_t *repeated = (uint8_t *)malloc(3 * sizeof(data) + 1);
+    if (!repeated) return 1;
+    for (int r = 0; r < 3; r++) memcpy(repeated + r * sizeof(data), data, sizeof(data));
+    uint8_t whole[32];
+    ENGINES[0].digest(repeated, 3 * sizeof(data) - 5, 3 * sizeof(data) - 5, whole);
+    for (size_t e = 0; e < ENGINE_COUNT; e++) {
+        uint8_t pieces[32];
+        ENGINES[e].digest(data, sizeof(data), 3 * sizeof(data) - 5, pieces);
+        if (memcmp(pieces, whole, 32) != 0) {
+            printf("FAIL %s: repeated input differs from the whole input\n", ENGINES[e].name);
+            failures++;
+        }
+    }
+    free(repeated);
+
+#ifdef FH_BUILD_ARM_CRYPTO
+    // The streams of the interleaved kernel must not bleed into each other,
+    // which identical inputs would not show.
+    for (size_t len = 0; len <= sizeof(data); len += 64) {
+        SHA256_ARM_CTX a, b;
+        uint8_t got_a[32], got_b[32], want_a[32], want_b[32];
+        sha256_arm_init(&a);
+        sha256_arm_init(&b);
+        sha256_arm_update_x2(&a, data, &b, data + sizeof(data) - len, len);
+        sha256_arm_final(&a, got_a);
+        sha256_arm_final(&b, got_b);
+        ENGINES[0].digest(data, len, len, want_a);
+        ENGINES[0].digest(data + sizeof(data) - len, len, len, want_b);
+        if (memcmp(got_a, want_a, 32) != 0 || memcmp(got_b, want_b, 32) != 0) {
+            printf("FAIL ARM crypto, 2 streams: length %zu with distinct inputs\n", len);
+            failures++;
+        }
+    }
+#endif
+
+    printf("%s: %zu engines, %d failures\n", failures ? "FAILED" : "OK", ENGINE_COUNT, failures);
+    return failures ? 1 : 0;
+}
+
+// --- IN-MEMORY ---
+
+// Inputs larger than this are hashed as the same buffer over and over. It
+// is well past the last-level cache, so throughput is still memory-bound.
+#define BENCH_MEMORY_BUFFER (64 * 1024 * 1024)
+
+typedef struct {
+    const bench_engine *engine;
+    const uint8_t *data;
+    size_t len;
+    uint64_t total;
+} bench_memory_ctx;
+
+static uint64_t bench_memory_run(void *arg) {
+    bench_memory_ctx *ctx = (bench_memory_ctx *)arg;
+    uint8_t hash[32];
+    ctx->engine->digest(ctx->data, ctx->len, ctx->total, hash);
+    return ctx->total * (uint64_t)ctx->engine->streams;
+}
+
+static void bench_memory(uint64_t max_size, double ghz) {
+    size_t buffer_len = max_size < BENCH_MEMORY_BUFFER ? (size_t)max_size : BENCH_MEMORY_BUFFER;
+    uint8_t *data = (uint8_t *)malloc(buffer_len + 1);
+    if (!data) {
+        printf("Cannot allocate %llu bytes\n", (unsigned long long)buffer_len);
+        return;
+    }
+    bench_fill(data, buffer_len);
+
+    bench_print_header("engine (in memory)");
+    for (size_t e = 0; e < ENGINE_COUNT; e++) {
+        uint64_t size = 0;
+        for (;;) {
+            size_t len = size < buffer_len ? (size_t)size : buffer_len;
+            bench_memory_ctx ctx = { &ENGINES[e], data, len, size };
+            bench_memory_run(&ctx); // Warm-up
+            bench_stats s = bench_measure(bench_iterations(size), ghz, bench_memory_run, &ctx);
+            bench_print_row(ENGINES[e].name, size, &s);
+
+            if (size >= max_size) break;
+            size = size ? size * 16 : 64;
+            if (size > max_size) size = max_size;
+        }
+    }
+    free(data);
+}
+
+// --- FILES ---
+
+typedef struct {
+    const char *path;
+    uint64_t size;
+    int cold;
+    uint8_t *buffer;
+} bench_file_ctx;
+
+// Drops the file's pages so the next read comes from storage. Only clean
+// pages can be dropped, hence the sync first.
+static void bench_drop_cache(const char *path) {
+#if defined(_WIN32) || defined(__APPLE__)
+    (void)path;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+#endif
+}
+
+static uint64_t bench_file_run(void *arg) {
+    bench_file_ctx *ctx = (bench_file_ctx *)arg;
+    fh_hash_result result;
+    if (ctx->cold) bench_drop_cache(ctx->path);
+    fh_sha256_open_path(ctx->path, 0, UINT64_MAX, ctx->buffer, &result);
+    return ctx->size;
+}
+
+static int bench_write_file(const char *path, uint64_t size) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return 0;
+    uint8_t block[FH_BUFFER_SIZE];
+    bench_fill(block, sizeof(block));
+    uint64_t left = size;
+    int ok = 1;
+    while (ok && left > 0) {
+        size_t n = left < sizeof(block) ? (size_t)left : sizeof(block);
+        ok = fwrite(block, 1, n, file) == n;
+        left -= n;
+    }
+    return fclose(file) == 0 && ok;
+}
+
+static void bench_files(uint64_t max_size, double ghz, const char *dir) {
+    uint8_t *buffer = fh_buffer_acquire();
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/file_hash_bench.tmp", dir);
+    if (!buffer) return;
+
+#if defined(_WIN32) || defined(__APPLE__)
+    printf("(cold page cache runs are not supported on this platform)\n");
+#endif
+    bench_print_header("file hashing (" FH_ENGINE_NAME ")");
+    for (int cold = 0; cold <= 1; cold++) {
+        uint64_t size = 0;
+        for (;;) {
+            if (!bench_write_file(path, size)) {
+                printf("Cannot write %s\n", path);
+                break;
+            }
+            bench_file_ctx ctx = { path, size, cold, buffer };
+            bench_file_run(&ctx); // Warm-up, fills the page cache for warm runs
+            int iterations = bench_iterations(size);
+            if (cold && iterations > 50) iterations = 50;
+            bench_stats s = bench_measure(iterations, ghz, bench_file_run, &ctx);
+            bench_print_row(cold ? "cold cache" : "warm cache", size, &s);
+
+            if (size >= max_size) break;
+            size = size ? size * 16 : 64;
+            if (size > max_size) size = max_size;
+        }
+    }
+    remove(path);
+    fh_buffer_release(buffer);
+}
+
+// --- MAIN ---
+
+static uint64_t bench_parse_size(const char *text) {
+    char *end = NULL;
+    double value = strtod(text, &end);
+    switch (end ? *end : 0) {
+        case 'k': case 'K': value *= 1024.0; break;
+        case 'm': case 'M': value *= 1024.0 * 1024.0; break;
+        case 'g': case 'G': value *= 1024.0 * 1024.0 * 1024.0; break;
+        default: break;
+    }
+    return value > 0 ? (uint64_t)value : 0;
+}
+
+int main(int argc, char **argv) {
+    int verify = 0, memory = 0, files = 0;
+    uint64_t max_size = 256ull << 20;
+    double ghz = 0;
+    const char *dir = ".";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--verify") == 0) verify = 1;
+        else if (strcmp(argv[i], "--memory") == 0) memory = 1;
+        else if (strcmp(argv[i], "--files") == 0) files = 1;
+        else if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) max_size = bench_parse_size(argv[++i]);
+        else if (strcmp(argv[i], "--ghz") == 0 && i + 1 < argc) ghz = atof(argv[++i]);
+        else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) dir = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--verify] [--memory] [--files] [--max-size SIZE] [--ghz GHZ] [--dir DIR]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (!verify && !memory && !files) memory = 1;
+
+    if (verify && bench_verify() != 0) return 1;
+    if (memory) bench_memory(max_size, ghz);
+    if (files) bench_files(max_size, ghz, dir);
+    return 0;
+}
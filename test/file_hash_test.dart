@@ -1,5 +1,10 @@
+import 'dart:convert';
+import 'dart:ffi';
 import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
 
+import 'package:ffi/ffi.dart';
 import 'package:file_hash/file_hash.dart';
 import 'package:flutter_test/flutter_test.dart';
 import 'package:path/path.dart' as path;
@@ -7,21 +12,20 @@ import 'package:path/path.dart' as path;
 void main() {
   TestWidgetsFlutterBinding.ensureInitialized();
 
-  group('FileHash.computeSha256', () {
-    late Directory tempDir;
+  // Every test gets a fresh temporary directory for its files.
+  late Directory tempDir;
 
-    setUp(() async {
-      // Create a temporary directory for test files
-      tempDir = await Directory.systemTemp.createTemp('file_hash_test_');
-    });
+  setUp(() async {
+    tempDir = await Directory.systemTemp.createTemp('file_hash_test_');
+  });
 
-    tearDown(() async {
-      // Clean up temporary directory
-      if (await tempDir.exists()) {
-        await tempDir.delete(recursive: true);
-      }
-    });
+  tearDown(() async {
+    if (await tempDir.exists()) {
+      await tempDir.delete(recursive: true);
+    }
+  });
 
+  group('FileHash.computeSha256', () {
     test('computes correct SHA-256 hash for known content', () async {
       // Create a test file with known content
       final testFile = File(path.join(tempDir.path, 'test.txt'));
@@ -146,6 +150,22 @@ void main() {
       expect(hash, hasLength(64));
     });
 
+    test('handles non-ASCII and long paths', () async {
+      // sha256('Unicode path test')
+      const expected =
+          '42b3ed685ec3829433827bc6a2ff8776623311954997048915a01a99c603d312';
+      var dirPath = path.join(tempDir.path, 'données 数据 ✓');
+      // Nest until the full path is past the 260 character MAX_PATH.
+      while (dirPath.length < 300) {
+        dirPath = path.join(dirPath, 'nested_directory_${dirPath.length}');
+      }
+      await Directory(dirPath).create(recursive: true);
+      final testFile = File(path.join(dirPath, 'fichier é.txt'));
+      await testFile.writeAsString('Unicode path test');
+
+      expect(await FileHash.computeSha256(testFile.path), equals(expected));
+    });
+
     test('can hash multiple files concurrently', () async {
       // Create multiple test files
       final files = <File>[];
@@ -172,5 +192,865 @@ void main() {
       final uniqueHashes = hashes.toSet();
       expect(uniqueHashes.length, equals(5));
     });
+
+    test('can be called from a background isolate', () async {
+      final testFile = File(path.join(tempDir.path, 'test.txt'));
+      await testFile.writeAsString('Hello, World!');
+      final filePath = testFile.path;
+
+      // The background isolate resolves the symbols itself and hands their
+      // addresses on to the isolates it spawns.
+      final hashes = await Isolate.run(() async {
+        return [
+          await FileHash.computeSha256(filePath),
+          await FileHash.computeSha256(filePath, cacheMode: CacheMode.direct),
+          FileHash.computeSha256Sync(filePath).sha256,
+        ];
+      });
+
+      const expectedHash =
+          'dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f';
+      expect(hashes, everyElement(equals(expectedHash)));
+    });
+  });
+
+  group('FileHash.findDuplicates', () {
+    test('groups files with identical content', () async {
+      final a = File(path.join(tempDir.path, 'a.txt'));
+      final b = File(path.join(tempDir.path, 'b.txt'));
+      final c = File(path.join(tempDir.path, 'c.txt'));
+      await a.writeAsString('Same content');
+      await b.writeAsString('Same content');
+      await c.writeAsString('Diff content'); // Same size, different bytes
+
+      final groups = await FileHash.findDuplicates([a.path, b.path, c.path]);
+
+      expect(groups, equals([
+        [a.path, b.path],
+      ]));
+    });
+
+    test('detects differences outside the sampled head and tail', () async {
+      // 64 KB files that only differ in the middle, past the 4 KB samples
+      final data = List<int>.generate(64 * 1024, (i) => i % 251);
+      final changed = List<int>.from(data)..[32 * 1024] ^= 0xff;
+
+      final a = File(path.join(tempDir.path, 'a.bin'));
+      final b = File(path.join(tempDir.path, 'b.bin'));
+      final c = File(path.join(tempDir.path, 'c.bin'));
+      await a.writeAsBytes(data);
+      await b.writeAsBytes(changed);
+      await c.writeAsBytes(data);
+
+      final groups = await FileHash.findDuplicates([a.path, b.path, c.path]);
+
+      expect(groups, equals([
+        [a.path, c.path],
+      ]));
+    });
+
+    test('ignores non-existent files and unique files', () async {
+      final a = File(path.join(tempDir.path, 'a.txt'));
+      await a.writeAsString('Only one of these');
+      final missing = path.join(tempDir.path, 'does_not_exist.txt');
+
+      final groups = await FileHash.findDuplicates([a.path, missing]);
+
+      expect(groups, isEmpty);
+    });
+
+    test('groups empty files but not files that only report size 0', () async {
+      final a = File(path.join(tempDir.path, 'a.txt'));
+      final b = File(path.join(tempDir.path, 'b.txt'));
+      await a.create();
+      await b.create();
+      final paths = [a.path, b.path];
+      // procfs files report a size of 0 but have content
+      if (Platform.isLinux || Platform.isAndroid) paths.add('/proc/cpuinfo');
+
+      final groups = await FileHash.findDuplicates(paths);
+
+      expect(groups, equals([
+        [a.path, b.path],
+      ]));
+    });
+  });
+
+  group('FileHash.computeQuickFingerprint', () {
+    test('is stable and differs from the full SHA-256', () async {
+      final testFile = File(path.join(tempDir.path, 'test.txt'));
+      await testFile.writeAsString('Hello, World!');
+
+      final first = await FileHash.computeQuickFingerprint(testFile.path);
+      final second = await FileHash.computeQuickFingerprint(testFile.path);
+      final hash = await FileHash.computeSha256(testFile.path);
+
+      expect(first, matches(RegExp(r'^[a-f0-9]{64}$')));
+      expect(first, equals(second));
+      expect(first, isNot(equals(hash)));
+    });
+
+    test('changes when a sampled block or the size changes', () async {
+      // 1 MB file, far larger than the sampled blocks
+      final data = List<int>.generate(1024 * 1024, (i) => i % 251);
+      final testFile = File(path.join(tempDir.path, 'large.bin'));
+      await testFile.writeAsBytes(data);
+      final original = await FileHash.computeQuickFingerprint(testFile.path);
+
+      await testFile.writeAsBytes(List<int>.from(data)..[data.length - 1] ^= 1);
+      final tailEdited = await FileHash.computeQuickFingerprint(testFile.path);
+
+      await testFile.writeAsBytes(data + [0]);
+      final appended = await FileHash.computeQuickFingerprint(testFile.path);
+
+      expect(tailEdited, isNot(equals(original)));
+      expect(appended, isNot(equals(original)));
+    });
+
+    test('depends on the stripe count', () async {
+      final data = List<int>.generate(1024 * 1024, (i) => i % 251);
+      final testFile = File(path.join(tempDir.path, 'large.bin'));
+      await testFile.writeAsBytes(data);
+
+      final a = await FileHash.computeQuickFingerprint(testFile.path);
+      final b = await FileHash.computeQuickFingerprint(
+        testFile.path,
+        stripes: 2,
+      );
+
+      expect(a, isNot(equals(b)));
+    });
+
+    test('returns null for non-existent file', () async {
+      final nonExistentPath = path.join(tempDir.path, 'does_not_exist.txt');
+
+      final fingerprint = await FileHash.computeQuickFingerprint(
+        nonExistentPath,
+      );
+
+      expect(fingerprint, isNull);
+    });
+
+    test('returns null for a directory', () async {
+      expect(await FileHash.computeQuickFingerprint(tempDir.path), isNull);
+    });
+  });
+
+  group('FileHash.computeChunks', () {
+    List<int> pseudoRandomBytes(int length) {
+      // Deterministic xorshift so chunk boundaries are reproducible
+      var x = 0x12345678;
+      return List<int>.generate(length, (_) {
+        x ^= (x << 13) & 0xffffffff;
+        x ^= x >> 17;
+        x ^= (x << 5) & 0xffffffff;
+        return x & 0xff;
+      });
+    }
+
+    test('chunks cover the file and the whole-file hash matches', () async {
+      final testFile = File(path.join(tempDir.path, 'data.bin'));
+      await testFile.writeAsBytes(pseudoRandomBytes(1024 * 1024));
+
+      final result = await FileHash.computeChunks(
+        testFile.path,
+        minSize: 2 * 1024,
+        avgSize: 8 * 1024,
+        maxSize: 64 * 1024,
+      );
+      final hash = await FileHash.computeSha256(testFile.path);
+
+      expect(result, isNotNull);
+      expect(result!.sha256, equals(hash));
+      var expectedOffset = 0;
+      for (final chunk in result.chunks) {
+        expect(chunk.offset, equals(expectedOffset));
+        expect(chunk.length, lessThanOrEqualTo(64 * 1024));
+        expect(chunk.sha256, matches(RegExp(r'^[a-f0-9]{64}$')));
+        expectedOffset += chunk.length;
+      }
+      expect(expectedOffset, equals(1024 * 1024));
+    });
+
+    test('an insertion only changes nearby chunks', () async {
+      final data = pseudoRandomBytes(1024 * 1024);
+      final original = File(path.join(tempDir.path, 'original.bin'));
+      final edited = File(path.join(tempDir.path, 'edited.bin'));
+      await original.writeAsBytes(data);
+      await edited.writeAsBytes(
+        data.sublist(0, 1000) + [42] + data.sublist(1000),
+      );
+
+      final a = await FileHash.computeChunks(
+        original.path,
+        minSize: 2 * 1024,
+        avgSize: 8 * 1024,
+        maxSize: 64 * 1024,
+      );
+      final b = await FileHash.computeChunks(
+        edited.path,
+        minSize: 2 * 1024,
+        avgSize: 8 * 1024,
+        maxSize: 64 * 1024,
+      );
+
+      final originalChunks = a!.chunks.map((c) => c.sha256).toSet();
+      final shared = b!.chunks.where((c) => originalChunks.contains(c.sha256));
+      expect(shared.length, greaterThanOrEqualTo(a.chunks.length - 2));
+    });
+
+    test('returns no chunks for an empty file', () async {
+      final testFile = File(path.join(tempDir.path, 'empty.bin'));
+      await testFile.writeAsBytes([]);
+
+      final result = await FileHash.computeChunks(testFile.path);
+
+      expect(result, isNotNull);
+      expect(result!.chunks, isEmpty);
+      expect(
+        result.sha256,
+        equals(
+          'e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855',
+        ),
+      );
+    });
+
+    test('returns null for non-existent file or invalid sizes', () async {
+      final testFile = File(path.join(tempDir.path, 'data.bin'));
+      await testFile.writeAsString('Some content');
+
+      final missing = await FileHash.computeChunks(
+        path.join(tempDir.path, 'does_not_exist.txt'),
+      );
+      final invalid = await FileHash.computeChunks(
+        testFile.path,
+        minSize: 64 * 1024,
+        avgSize: 8 * 1024,
+      );
+
+      expect(missing, isNull);
+      expect(invalid, isNull);
+    });
+  });
+
+  group('FileHash rsync signatures and deltas', () {
+    String tempPath(String name) => path.join(tempDir.path, name);
+
+    test('round-trips an edited file through signature, delta and patch',
+        () async {
+      final data = List<int>.generate(512 * 1024, (i) => (i * 31) % 251);
+      final edited = data.sublist(0, 100000) +
+          List<int>.filled(300, 7) +
+          data.sublist(100000);
+      await File(tempPath('old.bin')).writeAsBytes(data);
+      await File(tempPath('new.bin')).writeAsBytes(edited);
+
+      expect(
+        await FileHash.createSignature(tempPath('old.bin'), tempPath('sig')),
+        isTrue,
+      );
+      expect(
+        await FileHash.createDelta(
+          tempPath('sig'),
+          tempPath('new.bin'),
+          tempPath('delta'),
+        ),
+        isTrue,
+      );
+      expect(
+        await FileHash.applyDelta(
+          tempPath('old.bin'),
+          tempPath('delta'),
+          tempPath('out.bin'),
+        ),
+        isTrue,
+      );
+
+      expect(await File(tempPath('out.bin')).readAsBytes(), equals(edited));
+      // Only the edited region should travel as literal data
+      expect(await File(tempPath('delta')).length(), lessThan(32 * 1024));
+    });
+
+    test('rejects a delta applied to the wrong basis', () async {
+      await File(tempPath('old.bin')).writeAsString('Original content');
+      await File(tempPath('new.bin')).writeAsString('Original content!');
+      await File(tempPath('other.bin')).writeAsString('Something else entirely');
+
+      await FileHash.createSignature(tempPath('old.bin'), tempPath('sig'));
+      await FileHash.createDelta(
+        tempPath('sig'),
+        tempPath('new.bin'),
+        tempPath('delta'),
+      );
+      final applied = await FileHash.applyDelta(
+        tempPath('other.bin'),
+        tempPath('delta'),
+        tempPath('out.bin'),
+      );
+
+      expect(applied, isFalse);
+      expect(File(tempPath('out.bin')).existsSync(), isFalse);
+    });
+
+    test('rejects a delta that copies blocks past the basis', () async {
+      await File(tempPath('old.bin')).writeAsString('Original content');
+      // "FHD1", block length 1024, size 2^40, then a copy of 2^32 - 1 blocks
+      // starting at block 2^40
+      final delta = BytesBuilder()
+        ..add(ascii.encode('FHD1'))
+        ..add([0x00, 0x04, 0x00, 0x00])
+        ..add([0, 0, 0, 0, 0, 1, 0, 0])
+        ..add([0x01])
+        ..add([0, 0, 0, 0, 0, 1, 0, 0])
+        ..add([0xff, 0xff, 0xff, 0xff]);
+      await File(tempPath('delta')).writeAsBytes(delta.takeBytes());
+
+      final applied = await FileHash.applyDelta(
+        tempPath('old.bin'),
+        tempPath('delta'),
+        tempPath('out.bin'),
+      );
+
+      expect(applied, isFalse);
+      expect(File(tempPath('out.bin')).existsSync(), isFalse);
+    });
+
+    test('rejects a signature whose header overstates its blocks', () async {
+      await File(tempPath('new.bin')).writeAsString('New content');
+      // "FHS1", block length 1, size 2^63 + 1, then a single block entry
+      final signature = BytesBuilder()
+        ..add(ascii.encode('FHS1'))
+        ..add([0x01, 0x00, 0x00, 0x00])
+        ..add([0x01, 0, 0, 0, 0, 0, 0, 0x80])
+        ..add(List<int>.filled(36, 0));
+      await File(tempPath('sig')).writeAsBytes(signature.takeBytes());
+
+      final created = await FileHash.createDelta(
+        tempPath('sig'),
+        tempPath('new.bin'),
+        tempPath('delta'),
+      );
+
+      expect(created, isFalse);
+    });
+
+    test('rejects a truncated signature', () async {
+      await File(tempPath('old.bin')).writeAsBytes(List<int>.filled(4096, 1));
+      await File(tempPath('new.bin')).writeAsString('New content');
+      await FileHash.createSignature(
+        tempPath('old.bin'),
+        tempPath('sig'),
+        blockSize: 1024,
+      );
+      final bytes = await File(tempPath('sig')).readAsBytes();
+      await File(
+        tempPath('sig'),
+      ).writeAsBytes(bytes.sublist(0, bytes.length - 1));
+
+      final created = await FileHash.createDelta(
+        tempPath('sig'),
+        tempPath('new.bin'),
+        tempPath('delta'),
+      );
+
+      expect(created, isFalse);
+    });
+
+    test('returns false for non-existent file', () async {
+      final created = await FileHash.createSignature(
+        tempPath('does_not_exist.txt'),
+        tempPath('sig'),
+      );
+
+      expect(created, isFalse);
+    });
+  });
+
+  group('FileHash verification', () {
+    // SHA-256 of "Hello, World!"
+    const helloHash =
+        'dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f';
+    // SHA-256 of the empty string
+    const emptyHash =
+        'e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855';
+
+    test('verifySha256 reports match, mismatch and unreadable', () async {
+      final testFile = File(path.join(tempDir.path, 'test.txt'));
+      await testFile.writeAsString('Hello, World!');
+      final missing = path.join(tempDir.path, 'does_not_exist.txt');
+
+      expect(
+        await FileHash.verifySha256(testFile.path, helloHash),
+        equals(VerifyStatus.match),
+      );
+      expect(
+        await FileHash.verifySha256(testFile.path, emptyHash),
+        equals(VerifyStatus.mismatch),
+      );
+      expect(
+        await FileHash.verifySha256(missing, helloHash),
+        equals(VerifyStatus.unreadable),
+      );
+    });
+
+    test('verifySha256 rejects malformed digests', () async {
+      expect(
+        () => FileHash.verifySha256('unused', 'not-a-digest'),
+        throwsArgumentError,
+      );
+    });
+
+    test('verifyManifest checks every file and reports failures', () async {
+      final manifest = <String, String>{};
+      for (int i = 0; i < 10; i++) {
+        final file = File(path.join(tempDir.path, 'hello_$i.txt'));
+        await file.writeAsString('Hello, World!');
+        manifest[file.path] = helloHash;
+      }
+      final corrupt = File(path.join(tempDir.path, 'corrupt.txt'));
+      await corrupt.writeAsString('Hello, World?');
+      manifest[corrupt.path] = helloHash;
+      final missing = path.join(tempDir.path, 'does_not_exist.txt');
+      manifest[missing] = emptyHash;
+
+      final reported = <String, VerifyStatus>{};
+      final results = await FileHash.verifyManifest(
+        manifest,
+        threads: 3,
+        onFailure: (path, status) => reported[path] = status,
+      );
+
+      expect(results.length, equals(12));
+      expect(results[corrupt.path], equals(VerifyStatus.mismatch));
+      expect(results[missing], equals(VerifyStatus.unreadable));
+      expect(
+        results.values.where((s) => s == VerifyStatus.match).length,
+        equals(10),
+      );
+      expect(
+        reported,
+        equals({
+          corrupt.path: VerifyStatus.mismatch,
+          missing: VerifyStatus.unreadable,
+        }),
+      );
+    });
+
+    test('verifyManifest can stop at the first failure', () async {
+      final manifest = <String, String>{};
+      for (int i = 0; i < 20; i++) {
+        final file = File(path.join(tempDir.path, 'file_$i.txt'));
+        await file.writeAsString('Content $i');
+        manifest[file.path] = helloHash; // Every entry mismatches
+      }
+
+      final results = await FileHash.verifyManifest(
+        manifest,
+        threads: 1,
+        stopOnFirstFailure: true,
+      );
+
+      expect(
+        results.values.where((s) => s == VerifyStatus.mismatch).length,
+        equals(1),
+      );
+      expect(
+        results.values.where((s) => s == VerifyStatus.skipped).length,
+        equals(19),
+      );
+    });
+  });
+
+  group('FileHash.stats', () {
+    setUp(() {
+      FileHash.resetStats();
+    });
+
+    test('counts hashed files, bytes and failures', () async {
+      final testFile = File(path.join(tempDir.path, 'data.bin'));
+      await testFile.writeAsBytes(List<int>.filled(200 * 1024, 1));
+
+      await FileHash.computeSha256(testFile.path);
+      await FileHash.computeSha256(testFile.path);
+      await FileHash.computeSha256(path.join(tempDir.path, 'missing.bin'));
+
+      final stats = FileHash.stats;
+      expect(stats.engine, isNotEmpty);
+      expect(stats.files, equals(2));
+      expect(stats.failures, equals(1));
+      expect(stats.bytes, equals(2 * 200 * 1024));
+      expect(stats.readCalls, greaterThanOrEqualTo(2));
+    });
+
+    test('resetStats clears the counters', () async {
+      final testFile = File(path.join(tempDir.path, 'data.txt'));
+      await testFile.writeAsString('Some content');
+      await FileHash.computeSha256(testFile.path);
+
+      FileHash.resetStats();
+
+      final stats = FileHash.stats;
+      expect(stats.files, equals(0));
+      expect(stats.bytes, equals(0));
+    });
+  });
+
+  group('FileHash tracing', () {
+    test('records the phases of a hash as Chrome trace events', () async {
+      final testFile = File(path.join(tempDir.path, 'test.txt'));
+      await testFile.writeAsString('Hello, World!');
+
+      FileHash.startTracing();
+      await FileHash.computeSha256(testFile.path);
+      final trace = jsonDecode(FileHash.stopTracing()) as Map<String, dynamic>;
+
+      final events = (trace['traceEvents'] as List).cast<Map<String, dynamic>>();
+      final names = events.map((e) => e['name']).toSet();
+      expect(
+        names,
+        containsAll(['open', 'read', 'update', 'finalize', 'marshal']),
+      );
+      expect(
+        events.where((e) => e['ph'] == 'B').length,
+        equals(events.where((e) => e['ph'] == 'E').length),
+      );
+    });
+
+    test('records nothing while stopped', () async {
+      final testFile = File(path.join(tempDir.path, 'test.txt'));
+      await testFile.writeAsString('Hello, World!');
+
+      FileHash.startTracing();
+      FileHash.stopTracing();
+      await FileHash.computeSha256(testFile.path);
+      FileHash.startTracing();
+      final trace = jsonDecode(FileHash.stopTracing()) as Map<String, dynamic>;
+
+      expect(trace['traceEvents'], isEmpty);
+    });
+  });
+
+  group('FileHash batch hashing', () {
+    test('matches computeSha256 for files of mixed sizes', () async {
+      final paths = <String>[];
+      for (final size in [0, 1, 63, 64, 65, 65536, 200000, 1 << 20]) {
+        final file = File(path.join(tempDir.path, 'file_$size.bin'));
+        await file.writeAsBytes(List<int>.generate(size, (i) => (i * 7) & 0xff));
+        paths.add(file.path);
+      }
+
+      for (final threads in [0, 1, 3]) {
+        final digests = await FileHash.computeSha256Batch(
+          paths,
+          threads: threads,
+        );
+        expect(digests, hasLength(paths.length));
+        for (int i = 0; i < paths.length; i++) {
+          expect(digests[i], equals(await FileHash.computeSha256(paths[i])));
+        }
+      }
+    });
+
+    test('reports unreadable files as null', () async {
+      final testFile = File(path.join(tempDir.path, 'test.txt'));
+      await testFile.writeAsString('Hello, World!');
+      final missing = path.join(tempDir.path, 'does_not_exist.txt');
+
+      final digests = await FileHash.computeSha256Batch([
+        missing,
+        testFile.path,
+      ]);
+
+      expect(digests[0], isNull);
+      expect(
+        digests[1],
+        equals(
+          'dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f',
+        ),
+      );
+    });
+
+    test('returns an empty list for no paths', () async {
+      expect(await FileHash.computeSha256Batch([]), isEmpty);
+    });
+  });
+
+  group('FileHash cache modes', () {
+    test('every cache mode produces the same hash', () async {
+      for (final size in [0, 1, 4097, 65536, 3 * 1024 * 1024 + 123]) {
+        final file = File(path.join(tempDir.path, 'file_$size.bin'));
+        await file.writeAsBytes(List<int>.generate(size, (i) => (i * 13) & 0xff));
+
+        final expected = await FileHash.computeSha256(file.path);
+        for (final mode in CacheMode.values) {
+          expect(
+            await FileHash.computeSha256(file.path, cacheMode: mode),
+            equals(expected),
+            reason: '$mode, $size bytes',
+          );
+        }
+      }
+    });
+
+    test('returns null for a missing file in every mode', () async {
+      final missing = path.join(tempDir.path, 'does_not_exist.txt');
+      for (final mode in CacheMode.values) {
+        expect(await FileHash.computeSha256(missing, cacheMode: mode), isNull);
+      }
+    });
+  });
+
+  group('FileHash descriptors', () {
+    // Opens `filePath` read-only through libc, as a platform channel handing
+    // over a descriptor would.
+    int openDescriptor(String filePath) {
+      final open = DynamicLibrary.process()
+          .lookupFunction<
+            Int32 Function(Pointer<Utf8>, Int32),
+            int Function(Pointer<Utf8>, int)
+          >('open');
+      final pathPtr = filePath.toNativeUtf8();
+      try {
+        return open(pathPtr, 0);
+      } finally {
+        calloc.free(pathPtr);
+      }
+    }
+
+    void closeDescriptor(int fd) {
+      DynamicLibrary.process()
+          .lookupFunction<Int32 Function(Int32), int Function(int)>('close')(
+        fd,
+      );
+    }
+
+    test(
+      'hashes an open descriptor like the path',
+      () async {
+        final file = File(path.join(tempDir.path, 'data.bin'));
+        await file.writeAsBytes(
+          List<int>.generate(300000, (i) => (i * 11) & 0xff),
+        );
+        final expected = await FileHash.computeSha256(file.path);
+
+        for (final mode in CacheMode.values) {
+          final fd = openDescriptor(file.path);
+          expect(fd, greaterThanOrEqualTo(0));
+          try {
+            expect(
+              await FileHash.computeSha256FromDescriptor(fd, cacheMode: mode),
+              equals(expected),
+            );
+          } finally {
+            closeDescriptor(fd);
+          }
+        }
+      },
+      skip: Platform.isWindows ? 'libc open is POSIX only' : false,
+    );
+
+    test('returns null for an invalid descriptor', () async {
+      expect(await FileHash.computeSha256FromDescriptor(-1), isNull);
+    });
+  });
+
+  group('FileHash error reporting', () {
+    test('computeSha256OrThrow returns the digest', () async {
+      final testFile = File(path.join(tempDir.path, 'test.txt'));
+      await testFile.writeAsString('Hello, World!');
+
+      expect(
+        await FileHash.computeSha256OrThrow(testFile.path),
+        equals(
+          'dffd6021bb2bd5b0af676290809ec3a53191dd81c7f70a4b28688a362182986f',
+        ),
+      );
+    });
+
+    test('computeSha256OrThrow reports a missing file', () async {
+      final missing = path.join(tempDir.path, 'does_not_exist.txt');
+
+      await expectLater(
+        FileHash.computeSha256OrThrow(missing),
+        throwsA(
+          isA<FileHashNotFoundException>()
+              .having((e) => e.path, 'path', missing)
+              .having((e) => e.osError, 'osError', isNot(0))
+              .having((e) => e.isTransient, 'isTransient', isFalse),
+        ),
+      );
+    });
+
+    test('computeSha256WithMetadata matches File.stat', () async {
+      final testFile = File(path.join(tempDir.path, 'test.txt'));
+      await testFile.writeAsString('Hello, World!');
+      final stat = await testFile.stat();
+
+      final result = await FileHash.computeSha256WithMetadata(testFile.path);
+
+      expect(result.error, isNull);
+      expect(
+        result.sha256,
+        equals(await FileHash.computeSha256(testFile.path)),
+      );
+      expect(result.size, equals(13));
+      expect(
+        result.modified!.millisecondsSinceEpoch,
+        equals(stat.modified.millisecondsSinceEpoch),
+      );
+      expect(result.inode, isNot(0));
+    });
+
+    test('directories are not hashed', () async {
+      final dir = await Directory(path.join(tempDir.path, 'dir')).create();
+
+      expect(await FileHash.computeSha256(dir.path), isNull);
+      await expectLater(
+        FileHash.computeSha256OrThrow(dir.path),
+        throwsA(isA<FileHashNotAFileException>()),
+      );
+    });
+
+    test(
+      'FIFOs fail without waiting for a writer',
+      () async {
+        final fifo = path.join(tempDir.path, 'fifo');
+        final made = await Process.run('mkfifo', [fifo]);
+        expect(made.exitCode, equals(0));
+
+        final result = await FileHash.computeSha256WithMetadata(fifo);
+        expect(result.error, isA<FileHashNotAFileException>());
+
+        final batch = await FileHash.computeSha256BatchResults([fifo, fifo]);
+        expect(
+          batch.map((r) => r.error),
+          everyElement(isA<FileHashNotAFileException>()),
+        );
+        expect(await FileHash.computeQuickFingerprint(fifo), isNull);
+      },
+      skip: Platform.isWindows ? 'mkfifo is POSIX only' : false,
+      timeout: const Timeout(Duration(seconds: 30)),
+    );
+
+    test('batch results say why each file failed', () async {
+      final testFile = File(path.join(tempDir.path, 'test.txt'));
+      await testFile.writeAsString('Hello, World!');
+      final missing = path.join(tempDir.path, 'does_not_exist.txt');
+
+      final results = await FileHash.computeSha256BatchResults([
+        missing,
+        testFile.path,
+      ]);
+
+      expect(results[0].sha256, isNull);
+      expect(results[0].error, isA<FileHashNotFoundException>());
+      expect(results[0].error!.osError, isNot(0));
+      expect(results[1].error, isNull);
+      expect(results[1].size, equals(13));
+      expect(
+        results[1].sha256,
+        equals(await FileHash.computeSha256(testFile.path)),
+      );
+    });
+
+    test('a cancelled batch reports every file as cancelled', () async {
+      final paths = <String>[];
+      for (int i = 0; i < 10; i++) {
+        final file = File(path.join(tempDir.path, 'file_$i.bin'));
+        await file.writeAsBytes(List<int>.filled(100000, i));
+        paths.add(file.path);
+      }
+      final cancellation = HashCancellation()..cancel();
+
+      final results = await FileHash.computeSha256BatchResults(
+        paths,
+        cancellation: cancellation,
+      );
+
+      for (final result in results) {
+        expect(result.error, isA<FileHashCancelledException>());
+        expect(result.error!.isTransient, isTrue);
+      }
+    });
+
+    test('a file appended to while it is hashed fails as modified', () async {
+      final testFile = File(path.join(tempDir.path, 'growing.bin'));
+      await testFile.writeAsBytes(Uint8List(64 * 1024 * 1024));
+
+      // Keep appending from another isolate for the whole hash
+      final started = ReceivePort();
+      final writer = await Isolate.spawn(_appendUntilKilled, [
+        testFile.path,
+        started.sendPort,
+      ]);
+      await started.first;
+      try {
+        final result = await FileHash.computeSha256WithMetadata(testFile.path);
+
+        expect(result.sha256, isNull);
+        expect(result.error, isA<FileHashModifiedException>());
+        expect(result.error!.isTransient, isTrue);
+      } finally {
+        writer.kill(priority: Isolate.immediate);
+      }
+    });
+
+    test(
+      'procfs files hash although they report size 0',
+      () async {
+        final result = await FileHash.computeSha256WithMetadata(
+          '/proc/cpuinfo',
+        );
+        expect(result.error, isNull);
+        expect(result.size, equals(0));
+
+        final batch = await FileHash.computeSha256BatchResults([
+          '/proc/cpuinfo',
+          '/proc/self/status',
+        ]);
+        expect(batch.map((r) => r.error), everyElement(isNull));
+      },
+      skip: Platform.isLinux || Platform.isAndroid
+          ? false
+          : 'procfs is Linux only',
+    );
+
+    test('computeSha256Sync hashes small files only', () async {
+      final small = File(path.join(tempDir.path, 'small.txt'));
+      await small.writeAsString('Hello, World!');
+      final large = File(path.join(tempDir.path, 'large.bin'));
+      await large.writeAsBytes(
+        List<int>.filled(FileHash.syncSizeLimit + 1, 7),
+      );
+
+      final result = FileHash.computeSha256Sync(small.path);
+      expect(result.sha256, equals(await FileHash.computeSha256(small.path)));
+      expect(result.size, equals(13));
+
+      expect(
+        FileHash.computeSha256Sync(large.path).error,
+        isA<FileHashTooLargeException>(),
+      );
+      expect(
+        FileHash.computeSha256Sync(large.path, maxSize: 1 << 20).sha256,
+        equals(await FileHash.computeSha256(large.path)),
+      );
+      expect(
+        FileHash.computeSha256Sync(path.join(tempDir.path, 'missing')).error,
+        isA<FileHashNotFoundException>(),
+      );
+    });
   });
 }
+
+/// Appends to the file at `args[0]` until the isolate is killed, after
+/// signalling the `SendPort` in `args[1]` once the first write is done.
+void _appendUntilKilled(List<Object> args) {
+  final file = File(args[0] as String).openSync(mode: FileMode.append);
+  final chunk = Uint8List(4096);
+  file.writeFromSync(chunk);
+  (args[1] as SendPort).send(null);
+  for (;;) {
+    file.writeFromSync(chunk);
+  }
+}